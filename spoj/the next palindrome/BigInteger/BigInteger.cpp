@@ -1,128 +1,567 @@
-#ifndef BIGINTEGER_H
-#define BIGINTEGER_H
-
 #include <iostream>
 #include <string>
-#include <sstream>
 #include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <new>
 #include "BigInteger.h"
-#define MAX 10000 // for strings
 
-BigInteger::BigInteger() // empty constructor initializes zero
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BIGINTEGER_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// statistics
+//-------------------------------------------------------------
+// With BIGINTEGER_STATS defined, routines open a StatsScope on entry that
+// counts the call, buckets its operand size and adds up the ticks spent
+// until it returns. Only the outermost call of each routine on a thread
+// is recorded, so recursion (Karatsuba into Karatsuba, a divide and
+// conquer conversion into itself) folds into one call, while a routine
+// calling a different one shows up in both rows. Without the macro the
+// hooks expand to nothing.
+#ifdef BIGINTEGER_STATS
+static atomic<unsigned long long> statCalls[BigIntegerStats::routines];
+static atomic<unsigned long long> statTicks[BigIntegerStats::routines];
+static atomic<unsigned long long> statSizes[BigIntegerStats::routines][BigIntegerStats::sizeBuckets];
+static atomic<unsigned long long> statHeapAllocations, statArenaAllocations, statAllocatedBytes;
+static thread_local unsigned int statDepth[BigIntegerStats::routines];
+
+static unsigned long long ticks()
 {
-	number = "0";
-	sign = false;
+#ifdef BIGINTEGER_X86_SIMD
+	return __rdtsc(); // cycles of the time stamp counter
+#else
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+class StatsScope
+{
+	BigIntegerStats::Routine routine;
+	unsigned long long start;
+public:
+	StatsScope(BigIntegerStats::Routine r, size_t limbs) : routine(r), start(0)
+	{
+		if(statDepth[r]++ != 0)
+			return;
+		int bucket = 0; // bit length of limbs
+		for(; limbs != 0 && bucket < BigIntegerStats::sizeBuckets - 1; limbs >>= 1)
+			++bucket;
+		statCalls[r].fetch_add(1, memory_order_relaxed);
+		statSizes[r][bucket].fetch_add(1, memory_order_relaxed);
+		start = ticks();
+	}
+	~StatsScope()
+	{
+		if(--statDepth[routine] == 0)
+			statTicks[routine].fetch_add(ticks() - start, memory_order_relaxed);
+	}
+};
+
+static void recordAllocation(bool arena, size_t limbs)
+{
+	(arena ? statArenaAllocations : statHeapAllocations).fetch_add(1, memory_order_relaxed);
+	statAllocatedBytes.fetch_add(limbs * sizeof(unsigned int), memory_order_relaxed);
+}
+
+// prints what was collected when the program ends
+static struct StatsDump
+{
+	~StatsDump()
+	{
+		BigIntegerStats stats = BigIntegerStats::snapshot();
+		for(int r=0; r<BigIntegerStats::routines; ++r)
+			if(stats.routine[r].calls != 0)
+			{
+				stats.print(cerr);
+				return;
+			}
+	}
+} statsDump;
+
+#define BIGINTEGER_STATS_SCOPE(routine, limbs) StatsScope statsScope(BigIntegerStats::routine, limbs)
+#define BIGINTEGER_STATS_ALLOCATION(arena, limbs) recordAllocation(arena, limbs)
+#else
+#define BIGINTEGER_STATS_SCOPE(routine, limbs) ((void) 0)
+#define BIGINTEGER_STATS_ALLOCATION(arena, limbs) ((void) 0)
+#endif
+
+//-------------------------------------------------------------
+bool BigIntegerStats::enabled()
+{
+#ifdef BIGINTEGER_STATS
+	return true;
+#else
+	return false;
+#endif
 }
 //-------------------------------------------------------------
-BigInteger::BigInteger(string s) // "string" constructor
+BigIntegerStats BigIntegerStats::snapshot()
 {
-	if( isdigit(s[0]) ) // if not signed
+	BigIntegerStats stats = BigIntegerStats();
+#ifdef BIGINTEGER_STATS
+	for(int r=0; r<routines; ++r)
 	{
-		setNumber(s);
-		sign = false; // +ve
+		stats.routine[r].calls = statCalls[r].load(memory_order_relaxed);
+		stats.routine[r].ticks = statTicks[r].load(memory_order_relaxed);
+		for(int b=0; b<sizeBuckets; ++b)
+			stats.routine[r].sizes[b] = statSizes[r][b].load(memory_order_relaxed);
 	}
-	else
+	stats.heapAllocations = statHeapAllocations.load(memory_order_relaxed);
+	stats.arenaAllocations = statArenaAllocations.load(memory_order_relaxed);
+	stats.allocatedBytes = statAllocatedBytes.load(memory_order_relaxed);
+#endif
+	return stats;
+}
+//-------------------------------------------------------------
+void BigIntegerStats::reset()
+{
+#ifdef BIGINTEGER_STATS
+	for(int r=0; r<routines; ++r)
 	{
-		setNumber( s.substr(1) );
-		sign = (s[0] == '-');
+		statCalls[r].store(0, memory_order_relaxed);
+		statTicks[r].store(0, memory_order_relaxed);
+		for(int b=0; b<sizeBuckets; ++b)
+			statSizes[r][b].store(0, memory_order_relaxed);
 	}
+	statHeapAllocations.store(0, memory_order_relaxed);
+	statArenaAllocations.store(0, memory_order_relaxed);
+	statAllocatedBytes.store(0, memory_order_relaxed);
+#endif
 }
 //-------------------------------------------------------------
-BigInteger::BigInteger(string s, bool sin) // "string" constructor
+const char* BigIntegerStats::name(Routine r)
 {
-	setNumber( s );
-	setSign( sin );
+	static const char* names[routines] = { "compare", "add", "subtract", "increment", "multiply",
+		"schoolbook", "karatsuba", "toom3", "ntt", "divide", "parse", "print" };
+	return names[r];
 }
 //-------------------------------------------------------------
-BigInteger::BigInteger(int n) // "int" constructor
+// one row per routine that was called; sizes are listed as
+// "lowest limbs in the bucket:calls"
+void BigIntegerStats::print(ostream& os) const
 {
-	stringstream ss;
-	string s;
-	ss << n;
-	ss >> s;
+	os << "BigInteger statistics" << (enabled() ? "" : " (not compiled in, build with -DBIGINTEGER_STATS)") << endl;
+	os << "routine         calls          ticks    ticks/call  operand sizes" << endl;
+	for(int r=0; r<routines; ++r)
+	{
+		const Counter& c = routine[r];
+		if(c.calls == 0)
+			continue;
+		string row = name((Routine) r);
+		row.resize(10, ' ');
+		string calls = to_string(c.calls), total = to_string(c.ticks), each = to_string(c.ticks / c.calls);
+		row += string(11 - min<size_t>(calls.size(), 11), ' ') + calls;
+		row += string(15 - min<size_t>(total.size(), 15), ' ') + total;
+		row += string(14 - min<size_t>(each.size(), 14), ' ') + each + " ";
+		for(int b=0; b<sizeBuckets; ++b)
+			if(c.sizes[b] != 0)
+				row += " " + to_string(b == 0 ? 0ULL : 1ULL << (b - 1)) + ":" + to_string(c.sizes[b]);
+		os << row << endl;
+	}
+	os << "allocations: " << heapAllocations << " heap, " << arenaAllocations << " arena, "
+		<< allocatedBytes << " bytes" << endl;
+}
 
+//-------------------------------------------------------------
+// limb storage
+static thread_local BigIntegerArena* installedArena = nullptr;
 
-	if( isdigit(s[0]) ) // if not signed
+BigIntegerArena::BigIntegerArena(size_t blockBytes)
+	: head(nullptr), blockLimbs(max<size_t>(blockBytes / sizeof(unsigned int), 256)), outer(installedArena)
+{
+	installedArena = this;
+}
+//-------------------------------------------------------------
+BigIntegerArena::~BigIntegerArena()
+{
+	while(head != nullptr)
+	{
+		Block* next = head->next;
+		free(head);
+		head = next;
+	}
+	installedArena = outer;
+}
+//-------------------------------------------------------------
+void BigIntegerArena::reset()
+{
+	if(head == nullptr)
+		return;
+	while(head->next != nullptr)
+	{
+		Block* next = head->next->next;
+		free(head->next);
+		head->next = next;
+	}
+	head->used = 0;
+}
+//-------------------------------------------------------------
+size_t BigIntegerArena::bytesReserved() const
+{
+	size_t bytes = 0;
+	for(Block* b = head; b != nullptr; b = b->next)
+		bytes += sizeof(Block) + b->size * sizeof(unsigned int);
+	return bytes;
+}
+//-------------------------------------------------------------
+BigIntegerArena* BigIntegerArena::current()
+{
+	return installedArena;
+}
+//-------------------------------------------------------------
+// numbers built inside this scope live on the heap whatever arena is
+// installed, for caches that outlive it
+class HeapScope
+{
+	BigIntegerArena* saved;
+public:
+	HeapScope() : saved(installedArena) { installedArena = nullptr; }
+	~HeapScope() { installedArena = saved; }
+};
+//-------------------------------------------------------------
+// sizes are kept at multiples of 4 limbs; blocks come from malloc, which
+// aligns to 16 bytes on 64 bit targets, and their header is padded to 16,
+// so every allocation is 16 byte aligned there
+static size_t arenaRound(size_t n)
+{
+	return (n + 3) & ~(size_t) 3;
+}
+//-------------------------------------------------------------
+unsigned int* BigIntegerArena::allocate(size_t n)
+{
+	n = arenaRound(n);
+	if(head == nullptr || head->size - head->used < n)
+	{
+		size_t size = max(n, blockLimbs);
+		Block* b = (Block*) malloc(sizeof(Block) + size * sizeof(unsigned int));
+		if(b == nullptr)
+			throw bad_alloc();
+		b->next = head;
+		b->size = size;
+		b->used = 0;
+		head = b;
+		blockLimbs = min<size_t>(2 * blockLimbs, 1 << 20); // later blocks grow up to 4 MiB
+	}
+	unsigned int* p = head->data() + head->used;
+	head->used += n;
+	return p;
+}
+//-------------------------------------------------------------
+void BigIntegerArena::deallocate(unsigned int* p, size_t n)
+{
+	n = arenaRound(n);
+	if(head != nullptr && p + n == head->data() + head->used)
+		head->used -= n;
+}
+//-------------------------------------------------------------
+bool BigIntegerArena::extend(unsigned int* p, size_t n, size_t m)
+{
+	n = arenaRound(n);
+	m = arenaRound(m);
+	if(head == nullptr || p + n != head->data() + head->used || head->used - n + m > head->size)
+		return false;
+	head->used = head->used - n + m;
+	return true;
+}
+//-------------------------------------------------------------
+LimbVector::LimbVector(size_t n, limb value)
+	: LimbVector()
+{
+	resize(n, value);
+}
+//-------------------------------------------------------------
+LimbVector::LimbVector(const limb* first, const limb* last)
+	: LimbVector()
+{
+	assign(first, last);
+}
+//-------------------------------------------------------------
+LimbVector::LimbVector(const LimbVector& v)
+	: LimbVector()
+{
+	assign(v.begin(), v.end());
+}
+//-------------------------------------------------------------
+LimbVector::LimbVector(LimbVector&& v) noexcept
+	: buf(local), len(v.len), cap(inlineLimbs), arena(v.arena)
+{
+	if(v.buf == v.local)
+		memcpy(local, v.local, v.len * sizeof(limb)); // the rest may never have been written
+	else
+	{
+		buf = v.buf;
+		cap = v.cap;
+		v.buf = v.local;
+		v.cap = inlineLimbs;
+	}
+	v.len = 0;
+}
+//-------------------------------------------------------------
+LimbVector& LimbVector::operator = (const LimbVector& v)
+{
+	if(this != &v)
+		assign(v.begin(), v.end());
+	return (*this);
+}
+//-------------------------------------------------------------
+LimbVector& LimbVector::operator = (LimbVector&& v)
+{
+	if(this == &v)
+		return (*this);
+	if(v.buf == v.local || v.arena != arena)
+		assign(v.begin(), v.end());
+	else
+	{
+		release();
+		buf = v.buf;
+		len = v.len;
+		cap = v.cap;
+		v.buf = v.local;
+		v.cap = inlineLimbs;
+	}
+	v.len = 0;
+	return (*this);
+}
+//-------------------------------------------------------------
+bool LimbVector::operator == (const LimbVector& v) const
+{
+	return len == v.len && equal(begin(), end(), v.begin());
+}
+//-------------------------------------------------------------
+void LimbVector::resize(size_t n, limb value)
+{
+	if(n > cap)
+		grow(n);
+	if(n > len)
+		fill(buf + len, buf + n, value);
+	len = n;
+}
+//-------------------------------------------------------------
+void LimbVector::assign(size_t n, limb value)
+{
+	len = 0;
+	resize(n, value);
+}
+//-------------------------------------------------------------
+void LimbVector::assign(const limb* first, const limb* last)
+{
+	size_t n = last - first;
+	len = 0;
+	if(n > cap)
+		grow(n);
+	if(n != 0) // first may be null for an empty range
+		memmove(buf, first, n * sizeof(limb));
+	len = n;
+}
+//-------------------------------------------------------------
+void LimbVector::swap(LimbVector& v)
+{
+	if(arena != v.arena)
+	{
+		// neither buffer may change hands, so swap the contents. both
+		// grow first: if that throws the two are still untouched
+		reserve(v.len);
+		v.reserve(len);
+		size_t n = min(len, v.len);
+		swap_ranges(buf, buf + n, v.buf);
+		if(len > n)
+			memcpy(v.buf + n, buf + n, (len - n) * sizeof(limb));
+		else
+			memcpy(buf + n, v.buf + n, (v.len - n) * sizeof(limb));
+		std::swap(len, v.len);
+		return;
+	}
+	std::swap(buf, v.buf);
+	std::swap(len, v.len);
+	std::swap(cap, v.cap);
+	std::swap(local, v.local);
+	if(buf == v.local)
+		buf = local;
+	if(v.buf == local)
+		v.buf = v.local;
+}
+//-------------------------------------------------------------
+void LimbVector::grow(size_t n)
+{
+	size_t newCap = max(n, 2 * cap);
+	limb* p;
+	if(buf != local && arena == nullptr)
+	{
+		p = (limb*) realloc(buf, newCap * sizeof(limb));
+		if(p == nullptr)
+			throw bad_alloc();
+		BIGINTEGER_STATS_ALLOCATION(false, newCap);
+	}
+	else if(buf != local && arena->extend(buf, cap, newCap))
+		p = buf;
+	else
 	{
-		setNumber( s );
-		setSign( false ); // +ve
+		if(arena != nullptr)
+			p = arena->allocate(newCap);
+		else if((p = (limb*) malloc(newCap * sizeof(limb))) == nullptr)
+			throw bad_alloc();
+		BIGINTEGER_STATS_ALLOCATION(arena != nullptr, newCap);
+		memcpy(p, buf, len * sizeof(limb));
+		release();
+	}
+	buf = p;
+	cap = newCap;
+}
+//-------------------------------------------------------------
+void LimbVector::release()
+{
+	if(buf == local)
+		return;
+	if(arena != nullptr)
+		arena->deallocate(buf, cap);
+	else
+		free(buf);
+}
+//-------------------------------------------------------------
+BigInteger::BigInteger() // empty constructor initializes zero
+{
+	sign = false;
+}
+//-------------------------------------------------------------
+BigInteger::BigInteger(const string& s) // "string" constructor
+{
+	if( s.empty() || isdigit(s[0]) ) // if not signed
+	{
+		number = fromString(s.data(), s.size());
+		sign = false; // +ve
 	}
 	else
 	{
-		setNumber( s.substr(1) );
-		setSign( s[0] == '-' );
+		number = fromString(s.data() + 1, s.size() - 1);
+		sign = (s[0] == '-') && ! number.empty(); // avoid (-0) problem
 	}
 }
 //-------------------------------------------------------------
-void BigInteger::setNumber(string s)
+BigInteger::BigInteger(const string& s, bool sin) // "string" constructor
+{
+	setNumber( s );
+	setSign( sin );
+}
+//-------------------------------------------------------------
+BigInteger::BigInteger(int n) // "int" constructor
+{
+	// negate in unsigned arithmetic so INT_MIN does not overflow
+	unsigned long long magnitude = (n < 0) ? 0ULL - (unsigned long long) n : n;
+	number = fromInt( magnitude );
+	sign = (n < 0);
+}
+//-------------------------------------------------------------
+BigInteger::BigInteger(const BigInteger& b)
+	: number(b.number), sign(b.sign)
 {
-	number = s;
 }
 //-------------------------------------------------------------
-const string& BigInteger::getNumber() // retrieves the number
+BigInteger::BigInteger(BigInteger&& b) noexcept
+	: number(std::move(b.number)), sign(b.sign)
 {
-	return number;
+	b.number.clear();
+	b.sign = false;
+}
+//-------------------------------------------------------------
+void BigInteger::setNumber(const string& s)
+{
+	number = fromString(s.data(), s.size());
+	if(number.empty()) // avoid (-0) problem
+		sign = false;
+}
+//-------------------------------------------------------------
+string BigInteger::getNumber() const // retrieves the number
+{
+	return toString(number);
 }
 //-------------------------------------------------------------
 void BigInteger::setSign(bool s)
 {
-	sign = s;
+	sign = s && ! number.empty(); // zero is never -ve
 }
 //-------------------------------------------------------------
-const bool& BigInteger::getSign()
+const bool& BigInteger::getSign() const
 {
 	return sign;
 }
 //-------------------------------------------------------------
 // returns the absolute value
-BigInteger BigInteger::absolute()
+BigInteger BigInteger::absolute() const
+{
+	BigInteger abs = (*this);
+	abs.sign = false;
+	return abs;
+}
+//-------------------------------------------------------------
+void BigInteger::swap(BigInteger& b)
+{
+	number.swap( b.number );
+	std::swap( sign, b.sign );
+}
+//-------------------------------------------------------------
+BigInteger& BigInteger::operator = (const BigInteger& b)
 {
-	return BigInteger( getNumber() ); // +ve by default
+	number = b.number; // reuses our buffer when it is big enough
+	sign = b.sign;
+	return (*this);
 }
 //-------------------------------------------------------------
-void BigInteger::operator = (BigInteger b)
+BigInteger& BigInteger::operator = (BigInteger&& b)
 {
-	setNumber( b.getNumber() );
-	setSign( b.getSign() );
+	number = std::move(b.number); // leaves b zero
+	sign = b.sign;
+	b.sign = false;
+	return (*this);
 }
 //-------------------------------------------------------------
-bool BigInteger::operator == (BigInteger b)
+bool BigInteger::operator == (const BigInteger& b) const
 {
 	return equals((*this) , b);
 }
 //-------------------------------------------------------------
-bool BigInteger::operator != (BigInteger b)
+bool BigInteger::operator != (const BigInteger& b) const
 {
 	return ! equals((*this) , b);
 }
 //-------------------------------------------------------------
-bool BigInteger::operator > (BigInteger b)
+bool BigInteger::operator > (const BigInteger& b) const
 {
 	return greater((*this) , b);
 }
 //-------------------------------------------------------------
-bool BigInteger::operator < (BigInteger b)
+bool BigInteger::operator < (const BigInteger& b) const
 {
 	return less((*this) , b);
 }
 //-------------------------------------------------------------
-bool BigInteger::operator >= (BigInteger b)
+bool BigInteger::operator >= (const BigInteger& b) const
 {
-	return equals((*this) , b)
-		|| greater((*this), b);
+	return ! less((*this) , b);
 }
 //-------------------------------------------------------------
-bool BigInteger::operator <= (BigInteger b)
+bool BigInteger::operator <= (const BigInteger& b) const
 {
-	return equals((*this) , b) 
-		|| less((*this) , b);
+	return ! greater((*this) , b);
 }
 //-------------------------------------------------------------
 // increments the value, then returns its value
 BigInteger& BigInteger::operator ++() // prefix
 {
-	(*this) = (*this) + 1;
-	return (*this);
+	return advance(1);
 }
 //-------------------------------------------------------------
 // returns the value, then increments its value
@@ -130,7 +569,7 @@ BigInteger BigInteger::operator ++(int) // postfix
 {
 	BigInteger before = (*this);
 
-	(*this) = (*this) + 1;
+	advance(1);
 
 	return before;
 }
@@ -138,343 +577,3421 @@ BigInteger BigInteger::operator ++(int) // postfix
 // decrements the value, then return it
 BigInteger& BigInteger::operator --() // prefix
 {
-	(*this) = (*this) - 1;
-	return (*this);
-
+	return advance(-1);
 }
 //-------------------------------------------------------------
 // return the value, then decrements it
 BigInteger BigInteger::operator --(int) // postfix
-{	
+{
 	BigInteger before = (*this);
 
-	(*this) = (*this) - 1;
+	advance(-1);
 
 	return before;
 }
 //-------------------------------------------------------------
-BigInteger BigInteger::operator + (BigInteger b)
+// adds k in place; the carry or borrow almost never runs past the
+// lowest limb, so this is O(1) amortized and only allocates when the
+// number grows a limb
+BigInteger& BigInteger::advance(long long k)
 {
-	BigInteger addition;
-	if( getSign() == b.getSign() ) // both +ve or -ve
+	BIGINTEGER_STATS_SCOPE(Increment, number.size());
+	bool negative = (k < 0);
+	unsigned long long w = negative ? 0ULL - (unsigned long long) k : k;
+
+	if(sign == negative || number.empty()) // same signs, magnitudes add up
 	{
-		addition.setNumber( add(getNumber(), b.getNumber() ) );
-		addition.setSign( getSign() );
+		addWordInPlace(number, w);
+		sign = negative;
 	}
-	else // sign different
+	else if(number.size() > 2 || lowWord(number) >= w)
+		subtractWordInPlace(number, w);
+	else // crosses zero, the result fits in a word
 	{
-		if( absolute() > b.absolute() )
-		{
-			addition.setNumber( subtract(getNumber(), b.getNumber() ) );
-			addition.setSign( getSign() );
-		}
-		else
-		{
-			addition.setNumber( subtract(b.getNumber(), getNumber() ) );
-			addition.setSign( b.getSign() );
-		}
+		number = fromInt( w - lowWord(number) );
+		sign = negative;
 	}
-	if(addition.getNumber() == "0") // avoid (-0) problem
-		addition.setSign(false);
 
+	if(number.empty()) // avoid (-0) problem
+		sign = false;
+	return (*this);
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator + (const BigInteger& b) const &
+{
+	BigInteger addition;
+	addition.number.reserve( max(number.size(), b.number.size()) + 1 ); // room for the carry
+	addition.number = number;
+	addition.sign = sign;
+	addition.accumulate(b.number, b.sign);
 	return addition;
 }
 //-------------------------------------------------------------
-BigInteger BigInteger::operator - (BigInteger b)
+BigInteger BigInteger::operator + (const BigInteger& b) &&
+{
+	accumulate(b.number, b.sign);
+	return std::move(*this);
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator - (const BigInteger& b) const &
+{
+	BigInteger difference;
+	difference.number.reserve( max(number.size(), b.number.size()) + 1 );
+	difference.number = number;
+	difference.sign = sign;
+	difference.accumulate(b.number, ! b.sign); // x - y = x + (-y)
+	return difference;
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator - (const BigInteger& b) &&
 {
-	b.setSign( ! b.getSign() ); // x - y = x + (-y)
-	return (*this) + b;
+	accumulate(b.number, ! b.sign);
+	return std::move(*this);
 }
 //-------------------------------------------------------------
-BigInteger BigInteger::operator * (BigInteger b)
+BigInteger BigInteger::operator * (const BigInteger& b) const
 {
 	BigInteger mul;
 
-	mul.setNumber( multiply(getNumber(), b.getNumber() ) );
-	mul.setSign( getSign() != b.getSign() );
+	mul.number = multiply(number, b.number);
+	mul.sign = getSign() != b.getSign();
 
-	if(mul.getNumber() == "0") // avoid (-0) problem
-		mul.setSign(false);
+	if(mul.number.empty()) // avoid (-0) problem
+		mul.sign = false;
 
 	return mul;
 }
 //-------------------------------------------------------------
-// Warning: Denomerator must be within "long long" size not "BigInteger"
-BigInteger BigInteger::operator / (BigInteger b)
+BigInteger BigInteger::operator / (const BigInteger& b) const
 {
-	long long den = toInt( b.getNumber() );
-	BigInteger div;
-
-	div.setNumber( divide(getNumber(), den).first );
-	div.setSign( getSign() != b.getSign() );
-
-	if(div.getNumber() == "0") // avoid (-0) problem
-		div.setSign(false);
-
-	return div;
+	return divmod(b).first;
 }
 //-------------------------------------------------------------
-// Warning: Denomerator must be within "long long" size not "BigInteger"
-BigInteger BigInteger::operator % (BigInteger b)
+BigInteger BigInteger::operator % (const BigInteger& b) const
 {
-	long long den = toInt( b.getNumber() );
-
-	BigInteger rem;
-	long long rem_int = divide(number, den).second;
-	rem.setNumber( toString(rem_int) );
-	rem.setSign( getSign() != b.getSign() );
-
-	if(rem.getNumber() == "0") // avoid (-0) problem
-		rem.setSign(false);
-
-	return rem;
+	return divmod(b).second;
+}
+//-------------------------------------------------------------
+// quotient rounds toward zero and the remainder takes the sign of the
+// dividend, so (*this) == q * b + r like for built-in integers
+pair<BigInteger, BigInteger> BigInteger::divmod(const BigInteger& b) const
+{
+	pair<BigInteger, BigInteger> res;
+	divide(number, b.number, res.first.number, res.second.number);
+	res.first.sign = (getSign() != b.getSign()) && ! res.first.number.empty();
+	res.second.sign = getSign() && ! res.second.number.empty();
+	return res;
+}
+//-------------------------------------------------------------
+BigInteger& BigInteger::addmul(const BigInteger& a, const BigInteger& b)
+{
+	mulAccumulate(a.number, b.number, a.sign != b.sign);
+	return (*this);
+}
+//-------------------------------------------------------------
+BigInteger& BigInteger::submul(const BigInteger& a, const BigInteger& b)
+{
+	mulAccumulate(a.number, b.number, a.sign == b.sign);
+	return (*this);
 }
 //-------------------------------------------------------------
-BigInteger& BigInteger::operator += (BigInteger b)
+BigInteger& BigInteger::operator += (const BigInteger& b)
 {
-	(*this) = (*this) + b;
+	accumulate(b.number, b.sign);
 	return (*this);
 }
 //-------------------------------------------------------------
-BigInteger& BigInteger::operator -= (BigInteger b)
+BigInteger& BigInteger::operator -= (const BigInteger& b)
 {
-	(*this) = (*this) - b;
+	accumulate(b.number, ! b.sign);
 	return (*this);
 }
 //-------------------------------------------------------------
-BigInteger& BigInteger::operator *= (BigInteger b)
+BigInteger& BigInteger::operator *= (const BigInteger& b)
 {
 	(*this) = (*this) * b;
 	return (*this);
 }
 //-------------------------------------------------------------
-BigInteger& BigInteger::operator /= (BigInteger b)
+BigInteger& BigInteger::operator /= (const BigInteger& b)
 {
-	(*this) = (*this) / b;
+	(*this) = divmod(b).first;
 	return (*this);
 }
 //-------------------------------------------------------------
-BigInteger& BigInteger::operator %= (BigInteger b)
+BigInteger& BigInteger::operator %= (const BigInteger& b)
 {
-	(*this) = (*this) % b;
+	(*this) = divmod(b).second;
 	return (*this);
 }
 //-------------------------------------------------------------
-BigInteger& BigInteger::operator [] (int n)
+BigInteger BigInteger::operator -() const & // unary minus sign
 {
-	return *(this + (n*sizeof(BigInteger)));
+	BigInteger neg = (*this);
+	neg.sign = ! sign && ! number.empty();
+	return neg;
 }
 //-------------------------------------------------------------
-BigInteger BigInteger::operator -() // unary minus sign
+BigInteger BigInteger::operator -() &&
 {
-	return (*this) * -1;
+	sign = ! sign && ! number.empty();
+	return std::move(*this);
 }
 //-------------------------------------------------------------
-BigInteger::operator string() // for conversion from BigInteger to string
+BigInteger::operator string() const // for conversion from BigInteger to string
 {
 	string signedString = ( getSign() ) ? "-" : ""; // if +ve, don't print + sign
-	signedString += number;
+	toDecimal(number, signedString);
 	return signedString;
 }
 //-------------------------------------------------------------
-
-bool BigInteger::equals(BigInteger n1, BigInteger n2)
+// without a field width the digits go to the stream buffer in blocks;
+// padding needs the length first, so that builds the string
+ostream& operator << (ostream& os, const BigInteger& n)
 {
-	return n1.getNumber() == n2.getNumber()
-		&& n1.getSign() == n2.getSign();
-}
+	if(os.width() > 0)
+	{
+		string out = n.sign ? "-" : "";
+		BigInteger::toDecimal(n.number, out);
+		return os << out;
+	}
 
+	ostream::sentry ok(os);
+	if(! ok)
+		return os;
+	streambuf* out = os.rdbuf();
+	if((n.sign && out->sputc('-') == ostream::traits_type::eof()) || ! BigInteger::toDecimal(n.number, out))
+		os.setstate(ios::badbit);
+	return os;
+}
 //-------------------------------------------------------------
-bool BigInteger::less(BigInteger n1, BigInteger n2)
+// reads [+-]digits straight off the stream buffer; fails without digits
+istream& operator >> (istream& is, BigInteger& n)
 {
-	bool sign1 = n1.getSign();
-	bool sign2 = n2.getSign();
-
-	if(sign1 && ! sign2) // if n1 is -ve and n2 is +ve
-		return true;
-
-	else if(! sign1 && sign2)
-		return false;
+	istream::sentry ok(is); // skips leading white space
+	if(! ok)
+		return is;
 
-	else if(! sign1) // both +ve
+	streambuf* in = is.rdbuf();
+	const int eof = istream::traits_type::eof();
+	string digits;
+	bool negative = false;
+	int c = in->sgetc();
+	if(c == '-' || c == '+')
 	{
-		if(n1.getNumber().length() < n2.getNumber().length() )
-			return true;
-		if(n1.getNumber().length() > n2.getNumber().length() )
-			return false;
-		return n1.getNumber() < n2.getNumber();
+		negative = (c == '-');
+		c = in->snextc();
 	}
-	else // both -ve
+	while(c != eof && isdigit(c))
 	{
-		if(n1.getNumber().length() > n2.getNumber().length())
-			return true;
-		if(n1.getNumber().length() < n2.getNumber().length())
-			return false;
-		return n1.getNumber().compare( n2.getNumber() ) > 0; // greater with -ve sign is LESS
+		digits += (char) c;
+		c = in->snextc();
 	}
+
+	if(c == eof)
+		is.setstate(ios::eofbit);
+	if(digits.empty())
+		is.setstate(ios::failbit);
+	else
+	{
+		n.number = BigInteger::fromString(digits.data(), digits.size());
+		n.sign = negative && ! n.number.empty(); // avoid (-0) problem
+	}
+	return is;
 }
 //-------------------------------------------------------------
-bool BigInteger::greater(BigInteger n1, BigInteger n2)
+// (*this) += mag or (*this) -= mag without a temporary; safe when mag
+// is our own number
+void BigInteger::accumulate(const limbs& mag, bool negative)
 {
-	return ! equals(n1, n2) && ! less(n1, n2);
-}
+	if(sign == negative) // same signs, magnitudes add up
+		addInPlace(number, mag);
+	else if(compare(number, mag) >= 0)
+		subtractInPlace(number, mag);
+	else
+	{
+		subtractFromInPlace(number, mag);
+		sign = negative;
+	}
 
+	if(number.empty()) // avoid (-0) problem
+		sign = false;
+}
 //-------------------------------------------------------------
-// adds two strings and returns their sum in as a string
-string BigInteger::add(string number1, string number2)
+// (*this) += (-1)^negative * a * b. small products are added or
+// subtracted row by row straight into our limbs; if a subtraction
+// crosses zero the two's complement left behind is negated back
+void BigInteger::mulAccumulate(const limbs& a, const limbs& b, bool negative)
 {
-	string add = (number1.length() > number2.length()) ?  number1 : number2;
-	char carry = '0';
-	int differenceInLength = abs( (int) (number1.size() - number2.size()) );
-
-	if(number1.size() > number2.size())
-		number2.insert(0, differenceInLength, '0'); // put zeros from left
+	if(a.empty() || b.empty())
+		return;
+	if(&a == &number || &b == &number || min(a.size(), b.size()) >= karatsubaThreshold)
+	{
+		limbs product(a.size() + b.size());
+		mul(a.data(), a.size(), b.data(), b.size(), product.data());
+		trim(product);
+		accumulate(product, negative);
+		return;
+	}
 
-	else// if(number1.size() < number2.size())
-		number1.insert(0, differenceInLength, '0');
+	const limbs& x = (a.size() >= b.size()) ? a : b; // rows of x times one limb of y
+	const limbs& y = (a.size() >= b.size()) ? b : a;
+	if(number.empty())
+		sign = negative;
+	bool adding = (sign == negative);
+	size_t len = max(number.size(), x.size() + y.size()) + 1;
+	number.resize(len, 0);
 
-	for(int i=number1.size()-1; i>=0; --i)
+	limb* acc = number.data();
+	dlimb out = 0; // carry or borrow past the top limb
+	for(size_t j=0; j<y.size(); ++j)
 	{
-		add[i] = ((carry-'0')+(number1[i]-'0')+(number2[i]-'0')) + '0';
-
-		if(i != 0)
-		{	
-			if(add[i] > '9')
+		dlimb carry = 0;
+		for(size_t i=0; i<x.size(); ++i)
+		{
+			dlimb t = (dlimb) x[i] * y[j] + carry;
+			if(adding)
+			{
+				t += acc[i + j];
+				acc[i + j] = (limb) t;
+				carry = t >> 32;
+			}
+			else
+			{
+				limb low = (limb) t;
+				carry = (t >> 32) + (acc[i + j] < low);
+				acc[i + j] -= low;
+			}
+		}
+		for(size_t k=j+x.size(); carry && k<len; ++k)
+		{
+			if(adding)
 			{
-				add[i] -= 10;
-				carry = '1';
+				carry += acc[k];
+				acc[k] = (limb) carry;
+				carry >>= 32;
 			}
 			else
-				carry = '0';
+			{
+				limb old = acc[k], low = (limb) carry; // a row's borrow can reach 2^32
+				acc[k] = old - low;
+				carry = (carry >> 32) + (old < low);
+			}
 		}
+		out += carry;
 	}
-	if(add[0] > '9')
+
+	if(! adding && out)
 	{
-		add[0]-= 10;
-		add.insert(0,1,'1');
+		// went below zero: |acc| = B^len - acc
+		dlimb carry = 1;
+		for(size_t k=0; k<len; ++k)
+		{
+			carry += (limb) ~acc[k];
+			acc[k] = (limb) carry;
+			carry >>= 32;
+		}
+		sign = ! sign;
 	}
-	return add;
-}
 
+	trim(number);
+	if(number.empty()) // avoid (-0) problem
+		sign = false;
+}
 //-------------------------------------------------------------
-// subtracts two strings and returns their sum in as a string
-string BigInteger::subtract(string number1, string number2)
+
+bool BigInteger::equals(const BigInteger& n1, const BigInteger& n2)
 {
-	string sub = (number1.length()>number2.length())? number1 : number2;
-	int differenceInLength = abs( (int)(number1.size() - number2.size()) );
+	return n1.number == n2.number
+		&& n1.getSign() == n2.getSign();
+}
 
-	if(number1.size() > number2.size())	
-		number2.insert(0, differenceInLength, '0');
+//-------------------------------------------------------------
+bool BigInteger::less(const BigInteger& n1, const BigInteger& n2)
+{
+	bool sign1 = n1.getSign();
+	bool sign2 = n2.getSign();
 
-	else
-		number1.insert(0, differenceInLength, '0');
+	if(sign1 && ! sign2) // if n1 is -ve and n2 is +ve
+		return true;
+
+	else if(! sign1 && sign2)
+		return false;
+
+	else if(! sign1) // both +ve
+		return compare(n1.number, n2.number) < 0;
+	else // both -ve
+		return compare(n1.number, n2.number) > 0; // greater with -ve sign is LESS
+}
+//-------------------------------------------------------------
+bool BigInteger::greater(const BigInteger& n1, const BigInteger& n2)
+{
+	return less(n2, n1);
+}
+
+//-------------------------------------------------------------
+// vectorized kernels
+//-------------------------------------------------------------
+// The linear time loops (add, subtract, compare, digit conversion) come
+// in a scalar version and, on x86, SSE4.2 and AVX2 versions. The best
+// one the CPU supports is picked on first use.
+//
+// Vector addition is carry lookahead: add all lanes at once, then turn
+// the lanes that overflowed (generate) and the lanes that are all ones
+// (propagate) into bit masks G and P. Lane i receives a carry when bit i
+// of ((G << 1 | carry in) + P) ^ P is set, and the bit above the top
+// lane is the carry out. Subtraction works the same way with borrows,
+// a lane propagating a borrow when it is zero.
+
+struct SimdKernels
+{
+	const char* name;
+	// out[0..n) = a[0..n) +/- b[0..n) + carry/borrow in, returns the carry/borrow out; out may be a
+	BigInteger::limb (*addN)(BigInteger::limb* out, const BigInteger::limb* a, const BigInteger::limb* b, size_t n, BigInteger::limb carry);
+	BigInteger::limb (*subN)(BigInteger::limb* out, const BigInteger::limb* a, const BigInteger::limb* b, size_t n, BigInteger::limb borrow);
+	int (*compareN)(const BigInteger::limb* a, const BigInteger::limb* b, size_t n);
+	BigInteger::limb (*parse8)(const char* digits); // 8 ASCII digits to their value
+	void (*format8)(BigInteger::limb value, char* digits); // value < 10^8 to 8 ASCII digits
+};
+
+static BigInteger::limb addScalar(BigInteger::limb* out, const BigInteger::limb* a, const BigInteger::limb* b, size_t n, BigInteger::limb carry)
+{
+	BigInteger::dlimb c = carry;
+	for(size_t i=0; i<n; ++i)
+	{
+		c += (BigInteger::dlimb) a[i] + b[i];
+		out[i] = (BigInteger::limb) c;
+		c >>= 32;
+	}
+	return (BigInteger::limb) c;
+}
+
+static BigInteger::limb subScalar(BigInteger::limb* out, const BigInteger::limb* a, const BigInteger::limb* b, size_t n, BigInteger::limb borrow)
+{
+	for(size_t i=0; i<n; ++i)
+	{
+		BigInteger::dlimb d = (BigInteger::dlimb) a[i] - b[i] - borrow;
+		out[i] = (BigInteger::limb) d;
+		borrow = (BigInteger::limb) (d >> 63); // 1 if it wrapped around
+	}
+	return borrow;
+}
+
+static int compareScalar(const BigInteger::limb* a, const BigInteger::limb* b, size_t n)
+{
+	for(size_t i=n; i-->0; )
+		if(a[i] != b[i])
+			return (a[i] < b[i]) ? -1 : 1;
+	return 0;
+}
+
+static BigInteger::limb parse8Scalar(const char* digits)
+{
+	BigInteger::limb value = 0;
+	for(int k=0; k<8; ++k)
+		value = value * 10 + (digits[k] - '0');
+	return value;
+}
+
+static void format8Scalar(BigInteger::limb value, char* digits)
+{
+	for(int k=7; k>=0; --k, value/=10)
+		digits[k] = '0' + value % 10;
+}
+
+static const SimdKernels scalarKernels = { "scalar", addScalar, subScalar, compareScalar, parse8Scalar, format8Scalar };
+
+#ifdef BIGINTEGER_X86_SIMD
+
+// add and sub stay scalar at this width: the carry chain has to leave the
+// vector unit every 4 limbs, which costs more than the adds it saves
+__attribute__((target("sse4.2")))
+static int compareSse42(const BigInteger::limb* a, const BigInteger::limb* b, size_t n)
+{
+	size_t i = n;
+	for(; i>=4; i-=4)
+	{
+		__m128i va = _mm_loadu_si128((const __m128i*) (a + i - 4));
+		__m128i vb = _mm_loadu_si128((const __m128i*) (b + i - 4));
+		unsigned eq = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, vb)));
+		if(eq != 0xF)
+		{
+			size_t k = i - 4 + (31 - __builtin_clz(~eq & 0xF)); // highest lane that differs
+			return (a[k] < b[k]) ? -1 : 1;
+		}
+	}
+	return compareScalar(a, b, i);
+}
+
+// pairs of digits, then quads, then the two quads: 8 digits in 4 multiplies
+__attribute__((target("sse4.2")))
+static BigInteger::limb parse8Sse42(const char* digits)
+{
+	__m128i v = _mm_sub_epi8(_mm_loadl_epi64((const __m128i*) digits), _mm_set1_epi8('0'));
+	v = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+	v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+	v = _mm_packus_epi32(v, v);
+	v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+	return (BigInteger::limb) _mm_cvtsi128_si32(v);
+}
+
+// W. Mula's SSE2 conversion: split into two 4 digit halves, divide each
+// by 1000, 100, 10 and 1 in parallel with fixed point reciprocals, then
+// subtract 10 times the neighbouring quotient to isolate each digit
+__attribute__((target("sse4.2")))
+static void format8Sse42(BigInteger::limb value, char* digits)
+{
+	const __m128i divPowers = _mm_setr_epi16(8389, 5243, 13108, (short) 32768, 8389, 5243, 13108, (short) 32768);
+	const __m128i shiftPowers = _mm_setr_epi16(1 << (16 - (23 + 2 - 16)), 1 << (16 - (19 + 2 - 16)), 1 << (16 - 1 - 2), 1 << 15,
+		1 << (16 - (23 + 2 - 16)), 1 << (16 - (19 + 2 - 16)), 1 << (16 - 1 - 2), 1 << 15);
+
+	__m128i abcdefgh = _mm_cvtsi32_si128(value);
+	__m128i abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, _mm_set1_epi32(0xD1B71759)), 45); // value / 10000
+	__m128i efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+
+	__m128i v = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+	v = _mm_unpacklo_epi16(v, v);
+	v = _mm_unpacklo_epi32(v, v); // [abcd x4, efgh x4], times 4
+	v = _mm_mulhi_epu16(_mm_mulhi_epu16(v, divPowers), shiftPowers); // [a, ab, abc, abcd, e, ef, efg, efgh]
+	v = _mm_sub_epi16(v, _mm_slli_epi64(_mm_mullo_epi16(v, _mm_set1_epi16(10)), 16));
+
+	v = _mm_add_epi8(_mm_packus_epi16(v, v), _mm_set1_epi8('0'));
+	_mm_storel_epi64((__m128i*) digits, v);
+}
+
+static const SimdKernels sse42Kernels = { "sse4.2", addScalar, subScalar, compareSse42, parse8Sse42, format8Sse42 };
+
+__attribute__((target("avx2")))
+static BigInteger::limb addAvx2(BigInteger::limb* out, const BigInteger::limb* a, const BigInteger::limb* b, size_t n, BigInteger::limb carry)
+{
+	const __m256i bias = _mm256_set1_epi32(0x80000000);
+	const __m256i ones = _mm256_set1_epi32(-1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	size_t i = 0;
+	for(; i+8<=n; i+=8)
+	{
+		__m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+		__m256i s = _mm256_add_epi32(va, vb);
+		unsigned g = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_xor_si256(va, bias), _mm256_xor_si256(s, bias))));
+		unsigned p = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(s, ones)));
+		unsigned sum = ((g << 1) | carry) + p;
+		__m256i cv = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(sum ^ p), lanes), _mm256_set1_epi32(1));
+		_mm256_storeu_si256((__m256i*) (out + i), _mm256_add_epi32(s, cv));
+		carry = sum >> 8;
+	}
+	return addScalar(out + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx2")))
+static BigInteger::limb subAvx2(BigInteger::limb* out, const BigInteger::limb* a, const BigInteger::limb* b, size_t n, BigInteger::limb borrow)
+{
+	const __m256i bias = _mm256_set1_epi32(0x80000000);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	size_t i = 0;
+	for(; i+8<=n; i+=8)
+	{
+		__m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+		__m256i d = _mm256_sub_epi32(va, vb);
+		unsigned g = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_xor_si256(vb, bias), _mm256_xor_si256(va, bias))));
+		unsigned p = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(d, zero)));
+		unsigned sum = ((g << 1) | borrow) + p;
+		__m256i bv = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(sum ^ p), lanes), _mm256_set1_epi32(1));
+		_mm256_storeu_si256((__m256i*) (out + i), _mm256_sub_epi32(d, bv));
+		borrow = sum >> 8;
+	}
+	return subScalar(out + i, a + i, b + i, n - i, borrow);
+}
 
-	for(int i=number1.length()-1; i>=0; --i)
+__attribute__((target("avx2")))
+static int compareAvx2(const BigInteger::limb* a, const BigInteger::limb* b, size_t n)
+{
+	size_t i = n;
+	for(; i>=8; i-=8)
 	{
-		if(number1[i] < number2[i])
+		__m256i va = _mm256_loadu_si256((const __m256i*) (a + i - 8));
+		__m256i vb = _mm256_loadu_si256((const __m256i*) (b + i - 8));
+		unsigned eq = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, vb)));
+		if(eq != 0xFF)
 		{
-			number1[i] += 10;
-			number1[i-1]--;
+			size_t k = i - 8 + (31 - __builtin_clz(~eq & 0xFF));
+			return (a[k] < b[k]) ? -1 : 1;
 		}
-		sub[i] = ((number1[i]-'0')-(number2[i]-'0')) + '0';
 	}
+	return compareSse42(a, b, i);
+}
+
+static const SimdKernels avx2Kernels = { "avx2", addAvx2, subAvx2, compareAvx2, parse8Sse42, format8Sse42 };
+
+#endif
+
+static const SimdKernels* bestKernels()
+{
+#ifdef BIGINTEGER_X86_SIMD
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		return &avx2Kernels;
+	if(__builtin_cpu_supports("sse4.2"))
+		return &sse42Kernels;
+#endif
+	return &scalarKernels;
+}
+
+static const SimdKernels*& activeKernels()
+{
+	static const SimdKernels* kernels = bestKernels();
+	return kernels;
+}
+
+static inline const SimdKernels& simd()
+{
+	return *activeKernels();
+}
+
+//-------------------------------------------------------------
+const char* BigInteger::simdLevel()
+{
+	return simd().name;
+}
+
+//-------------------------------------------------------------
+// lets tests and benchmarks pin a kernel set; not thread safe, call it
+// before other threads use BigInteger
+bool BigInteger::setSimdLevel(const string& level)
+{
+	const SimdKernels* candidates[] = {
+#ifdef BIGINTEGER_X86_SIMD
+		&avx2Kernels, &sse42Kernels,
+#endif
+		&scalarKernels };
+
+	for(size_t i=0; i<sizeof(candidates)/sizeof(candidates[0]); ++i)
+	{
+		if(level != candidates[i]->name)
+			continue;
+#ifdef BIGINTEGER_X86_SIMD
+		if((candidates[i] == &avx2Kernels && ! __builtin_cpu_supports("avx2"))
+			|| (candidates[i] == &sse42Kernels && ! __builtin_cpu_supports("sse4.2")))
+			return false;
+#endif
+		activeKernels() = candidates[i];
+		return true;
+	}
+	return false;
+}
+
+//-------------------------------------------------------------
+// compares two magnitudes, returns -1, 0 or 1
+int BigInteger::compare(const limbs& n1, const limbs& n2)
+{
+	BIGINTEGER_STATS_SCOPE(Compare, max(n1.size(), n2.size()));
+	if(n1.size() != n2.size())
+		return (n1.size() < n2.size()) ? -1 : 1;
+
+	return simd().compareN(n1.data(), n2.data(), n1.size());
+}
+
+//-------------------------------------------------------------
+// erases leading zero limbs
+void BigInteger::trim(limbs& n)
+{
+	while(! n.empty() && n.back() == 0)
+		n.pop_back();
+}
+
+//-------------------------------------------------------------
+// adds two magnitudes and returns their sum
+BigInteger::limbs BigInteger::add(const limbs& number1, const limbs& number2)
+{
+	BIGINTEGER_STATS_SCOPE(Add, max(number1.size(), number2.size()));
+	const limbs& longer = (number1.size() >= number2.size()) ? number1 : number2;
+	const limbs& shorter = (number1.size() >= number2.size()) ? number2 : number1;
+
+	limbs add(longer.size() + 1);
+	dlimb carry = simd().addN(add.data(), longer.data(), shorter.data(), shorter.size(), 0);
+	size_t i = shorter.size();
+
+	for(; i<longer.size(); ++i)
+	{
+		carry += longer[i];
+		add[i] = (limb) carry;
+		carry >>= 32;
+	}
+	add[i] = (limb) carry;
+
+	trim(add);
+	return add;
+}
+
+//-------------------------------------------------------------
+// subtracts two magnitudes and returns their difference,
+// number1 must not be smaller than number2
+BigInteger::limbs BigInteger::subtract(const limbs& number1, const limbs& number2)
+{
+	BIGINTEGER_STATS_SCOPE(Subtract, number1.size());
+	limbs sub(number1.size());
+	limb borrow = simd().subN(sub.data(), number1.data(), number2.data(), number2.size(), 0);
+	size_t i = number2.size();
 
-	while(sub[0]=='0' && sub.length()!=1) // erase leading zeros
-		sub.erase(0,1);
+	for(; i<number1.size(); ++i)
+	{
+		dlimb d = (dlimb) number1[i] - borrow;
+		sub[i] = (limb) d;
+		borrow = (limb) (d >> 63);
+	}
 
+	trim(sub); // erase leading zeros
 	return sub;
 }
 
 //-------------------------------------------------------------
-// multiplies two strings and returns their sum in as a string
-string BigInteger::multiply(string n1, string n2)
+// acc += n, growing acc by at most one limb
+void BigInteger::addInPlace(limbs& acc, const limbs& n)
+{
+	BIGINTEGER_STATS_SCOPE(Add, max(acc.size(), n.size()));
+	size_t len = n.size(); // n may be acc itself, read its size before resizing
+	if(acc.size() < len)
+		acc.resize(len, 0);
+
+	dlimb carry = simd().addN(acc.data(), acc.data(), n.data(), len, 0);
+	size_t i = len;
+	for(; carry && i<acc.size(); ++i)
+	{
+		carry += acc[i];
+		acc[i] = (limb) carry;
+		carry >>= 32;
+	}
+	if(carry)
+		acc.push_back( (limb) carry );
+}
+
+//-------------------------------------------------------------
+// acc -= n, acc must not be smaller than n
+void BigInteger::subtractInPlace(limbs& acc, const limbs& n)
+{
+	BIGINTEGER_STATS_SCOPE(Subtract, acc.size());
+	limb borrow = simd().subN(acc.data(), acc.data(), n.data(), n.size(), 0);
+	size_t i = n.size();
+	for(; borrow && i<acc.size(); ++i)
+	{
+		borrow = (acc[i] == 0);
+		--acc[i];
+	}
+
+	trim(acc);
+}
+
+//-------------------------------------------------------------
+// acc = n - acc, n must not be smaller than acc
+void BigInteger::subtractFromInPlace(limbs& acc, const limbs& n)
+{
+	BIGINTEGER_STATS_SCOPE(Subtract, n.size());
+	size_t had = acc.size();
+	acc.resize(n.size(), 0);
+
+	limb borrow = simd().subN(acc.data(), n.data(), acc.data(), had, 0);
+	for(size_t i=had; i<n.size(); ++i)
+	{
+		dlimb d = (dlimb) n[i] - borrow;
+		acc[i] = (limb) d;
+		borrow = (limb) (d >> 63);
+	}
+
+	trim(acc);
+}
+
+//-------------------------------------------------------------
+// acc += w in place
+void BigInteger::addWordInPlace(limbs& acc, unsigned long long w)
+{
+	dlimb carry = 0;
+	for(size_t i=0; w != 0 || carry != 0; ++i, w >>= 32)
+	{
+		if(i == acc.size())
+			acc.push_back(0);
+		carry += (dlimb) acc[i] + (limb) w;
+		acc[i] = (limb) carry;
+		carry >>= 32;
+	}
+}
+
+//-------------------------------------------------------------
+// acc -= w in place, acc must not be smaller than w
+void BigInteger::subtractWordInPlace(limbs& acc, unsigned long long w)
+{
+	limb borrow = 0;
+	for(size_t i=0; w != 0 || borrow != 0; ++i, w >>= 32)
+	{
+		dlimb d = (dlimb) acc[i] - (limb) w - borrow;
+		acc[i] = (limb) d;
+		borrow = (limb) (d >> 63);
+	}
+
+	trim(acc);
+}
+
+//-------------------------------------------------------------
+// multiplies two magnitudes and returns their product
+BigInteger::limbs BigInteger::multiply(const limbs& n1, const limbs& n2)
+{
+	if(n1.empty() || n2.empty())
+		return limbs();
+
+	limbs res(n1.size() + n2.size());
+	mul(&n1[0], n1.size(), &n2[0], n2.size(), &res[0]);
+
+	trim(res); // erase leading zeros
+	return res;
+}
+
+//-------------------------------------------------------------
+// parallel multiplication
+//-------------------------------------------------------------
+// A product that reaches parallelThreshold gets a budget of threads from
+// the pool, and every task it forks, however deep, draws on that budget:
+// a fork runs inline once the budget is spent. Tasks only write to
+// disjoint parts of buffers sized before the fork, so the limbs produced
+// are the same for any thread count. A thread waiting on its tasks runs
+// queued ones meanwhile, so nested forks cannot block the pool.
+size_t BigInteger::parallelThreshold = 2048;
+
+// threads one top level product may use, shared by all its tasks
+struct ThreadBudget
 {
-	if(n1.length() > n2.length()) 
-		n1.swap(n2);
+	int threads; // including the caller
+	atomic<int> spare; // forks that may still be queued
+	explicit ThreadBudget(int n) : threads(n), spare(n - 1) {}
+};
+
+static thread_local ThreadBudget* currentBudget = nullptr; // budget of the product running on this thread
+static thread_local unsigned threadLimit = 0; // innermost BigIntegerThreadLimit, 0 if none
+
+// workers pulling tasks from one queue
+class TaskPool
+{
+public:
+	static TaskPool& instance()
+	{
+		static TaskPool pool;
+		return pool;
+	}
+	~TaskPool() { resize(1); }
+
+	unsigned size() const { return count; }
+
+	// not safe while products are running
+	void resize(unsigned n)
+	{
+		{
+			lock_guard<mutex> lock(m);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(size_t i=0; i<workers.size(); ++i)
+			workers[i].join();
+		workers.clear();
+		stopping = false;
+		count = max(n, 1U);
+		for(unsigned i=1; i<count; ++i)
+			workers.push_back(thread(&TaskPool::work, this));
+	}
 
-	string res = "0";
-	for(int i=n1.length()-1; i>=0; --i)
+	// queues task and counts it in counter
+	void push(function<void()> task, size_t& counter)
 	{
-		string temp = n2;
-		int currentDigit = n1[i]-'0';
-		int carry = 0;
+		{
+			lock_guard<mutex> lock(m);
+			queue.push_back(move(task));
+			++counter;
+		}
+		wake.notify_all();
+	}
 
-		for(int j=temp.length()-1; j>=0; --j)
+	// counter is decremented under the pool lock, so waiters see it
+	void finished(size_t& counter)
+	{
 		{
-			temp[j] = ((temp[j]-'0') * currentDigit) + carry;
+			lock_guard<mutex> lock(m);
+			--counter;
+		}
+		wake.notify_all();
+	}
 
-			if(temp[j] > 9)
+	// runs queued tasks until counter drops to zero
+	void helpUntilZero(const size_t& counter)
+	{
+		unique_lock<mutex> lock(m);
+		while(counter != 0)
+		{
+			if(queue.empty())
 			{
-				carry = (temp[j]/10);
-				temp[j] -= (carry*10);
+				wake.wait(lock);
+				continue;
 			}
-			else
-				carry = 0;
+			function<void()> task = move(queue.front());
+			queue.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+private:
+	TaskPool() : count(1), stopping(false) {}
+
+	void work()
+	{
+		unique_lock<mutex> lock(m);
+		while(true)
+		{
+			wake.wait(lock, [this] { return stopping || ! queue.empty(); });
+			if(queue.empty())
+				return;
+			function<void()> task = move(queue.front());
+			queue.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+
+	atomic<unsigned> count; // threads including the caller
+	bool stopping;
+	mutex m;
+	condition_variable wake;
+	deque< function<void()> > queue;
+	vector<thread> workers;
+};
+
+// tasks forked by one kernel call. run() queues a task while the budget
+// lasts and runs it on the spot otherwise; wait() returns once all have
+// finished and rethrows the first exception one of them threw. a
+// disabled group runs everything inline
+class TaskGroup
+{
+public:
+	explicit TaskGroup(bool enabled) : budget(enabled ? currentBudget : nullptr), pending(0) {}
+	~TaskGroup() { join(); }
+
+	template<class F>
+	void run(F f)
+	{
+		if(budget == nullptr || budget->spare.fetch_sub(1) <= 0)
+		{
+			if(budget != nullptr)
+				budget->spare.fetch_add(1);
+			f();
+			return;
+		}
+
+		TaskPool::instance().push([this, f]()
+		{
+			ThreadBudget* saved = currentBudget;
+			currentBudget = budget;
+			try
+			{
+				HeapScope heap; // whatever thread runs it, a task leaves no limbs in an arena
+				f();
+			}
+			catch(...)
+			{
+				lock_guard<mutex> lock(errorMutex);
+				if(! error)
+					error = current_exception();
+			}
+			currentBudget = saved;
+			budget->spare.fetch_add(1);
+			TaskPool::instance().finished(pending); // last touch of this
+		}, pending);
+	}
 
-			temp[j] += '0'; // back to string mood
+	void wait()
+	{
+		join();
+		if(error)
+		{
+			exception_ptr e = error;
+			error = nullptr;
+			rethrow_exception(e);
 		}
+	}
+private:
+	void join()
+	{
+		if(budget != nullptr) // pending is read under the pool lock
+			TaskPool::instance().helpUntilZero(pending);
+	}
 
-		if(carry > 0)
-			temp.insert(temp.begin(), 1, '0' + carry);
-		
-		temp.append((n1.length()-i-1), '0'); // as like mult by 10, 100, 1000, 10000 and so on
+	ThreadBudget* budget;
+	size_t pending; // guarded by the pool lock once a task is queued
+	mutex errorMutex;
+	exception_ptr error;
+};
+
+// true if a product of this many limbs should fork its parts
+static bool forkable(size_t n)
+{
+	return currentBudget != nullptr && n >= BigInteger::parallelThreshold;
+}
 
-		res = add(res, temp); // O(n)
+// f(begin, end) over [0, n), split into one chunk per budgeted thread
+// as long as chunks keep at least grain items
+template<class F>
+static void parallelFor(size_t n, size_t grain, const F& f)
+{
+	size_t chunks = (currentBudget == nullptr) ? 1 : min<size_t>(currentBudget->threads, n / max<size_t>(grain, 1));
+	if(chunks <= 1)
+	{
+		f(0, n);
+		return;
 	}
 
-	while(res[0] == '0' && res.length()!=1) // erase leading zeros
-		res.erase(0,1);
+	TaskGroup group(true);
+	for(size_t c=1; c<chunks; ++c)
+		group.run([&f, n, c, chunks] { f(n * c / chunks, n * (c + 1) / chunks); });
+	f(0, n / chunks);
+	group.wait();
+}
 
-	return res;
+// threads a top level call started on this thread may use
+static unsigned budgetThreads()
+{
+	unsigned n = TaskPool::instance().size();
+	return (threadLimit != 0) ? min(n, threadLimit) : n;
 }
 
-//-------------------------------------------------------------
-// divides string on long long, returns pair(qutiont, remainder)
-pair<string, long long> BigInteger::divide(string n, long long den)
+// runs f with a budget of budgetThreads() installed for it and its forks
+template<class F>
+static void withBudget(F f)
 {
-	long long rem = 0;
-	string result; result.resize(MAX);
-	
-	for(int indx=0, len = n.length(); indx<len; ++indx)
+	ThreadBudget budget(budgetThreads());
+	currentBudget = &budget;
+	try
+	{
+		f();
+	}
+	catch(...)
 	{
-		rem = (rem * 10) + (n[indx] - '0');
-		result[indx] = rem / den + '0';
-		rem %= den;
+		currentBudget = nullptr;
+		throw;
 	}
-	result.resize( n.length() );
+	currentBudget = nullptr;
+}
+
+//-------------------------------------------------------------
+void BigInteger::setThreads(unsigned n)
+{
+	TaskPool::instance().resize(n);
+}
 
-	while( result[0] == '0' && result.length() != 1)
-		result.erase(0,1);
+unsigned BigInteger::threads()
+{
+	return TaskPool::instance().size();
+}
 
-	if(result.length() == 0)
-		result = "0";
+BigIntegerThreadLimit::BigIntegerThreadLimit(unsigned maxThreads)
+	: outer(threadLimit)
+{
+	threadLimit = max(maxThreads, 1U);
+	if(outer != 0)
+		threadLimit = min(threadLimit, outer);
+}
 
-	return make_pair(result, rem);
+BigIntegerThreadLimit::~BigIntegerThreadLimit()
+{
+	threadLimit = outer;
 }
 
 //-------------------------------------------------------------
-// converts long long to string
-string BigInteger::toString(long long n)
+// multiplication tiers
+//-------------------------------------------------------------
+size_t BigInteger::karatsubaThreshold = 48;
+size_t BigInteger::toom3Threshold = 768;
+size_t BigInteger::nttThreshold = 12288;
+
+// out[0..n) += in[0..m) where m <= n, returns the carry out of the top
+static BigInteger::limb addInto(BigInteger::limb* out, size_t n, const BigInteger::limb* in, size_t m)
 {
-	stringstream ss;
-	string temp;
+	BigInteger::dlimb carry = simd().addN(out, out, in, m, 0);
+	size_t i = m;
+	for(; carry && i<n; ++i)
+	{
+		carry += out[i];
+		out[i] = (BigInteger::limb) carry;
+		carry >>= 32;
+	}
+	return (BigInteger::limb) carry;
+}
 
-	ss << n;
-	ss >> temp;
+// out[0..n) -= in[0..m) where m <= n, returns the borrow out of the top
+static BigInteger::limb subInto(BigInteger::limb* out, size_t n, const BigInteger::limb* in, size_t m)
+{
+	BigInteger::limb borrow = simd().subN(out, out, in, m, 0);
+	size_t i = m;
+	for(; borrow && i<n; ++i)
+	{
+		borrow = (out[i] == 0);
+		--out[i];
+	}
+	return borrow;
+}
 
-	return temp;
+// length of a[0..n) without its leading zero limbs
+static size_t significant(const BigInteger::limb* a, size_t n)
+{
+	while(n > 0 && a[n-1] == 0)
+		--n;
+	return n;
 }
 
 //-------------------------------------------------------------
-// converts string to long long
-long long BigInteger::toInt(string s)
+void BigInteger::mul(const limb* a, size_t na, const limb* b, size_t nb, limb* out)
 {
-	long long sum = 0;
+	BIGINTEGER_STATS_SCOPE(Multiply, max(na, nb));
+	if(na < nb)
+	{
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
 
-	for(int i=0; i<s.length(); i++)
-		sum = (sum*10) + (s[i] - '0');
+	if(currentBudget == nullptr && nb >= parallelThreshold && budgetThreads() > 1)
+	{
+		withBudget([=] { mul(a, na, b, nb, out); }); // a top level product
+		return;
+	}
 
-	return sum;
+	// below 4 and 9 limbs the split pieces would not shrink, whatever the thresholds say
+	if(nb >= nttThreshold)
+		mulNTT(a, na, b, nb, out);
+	else if(nb < karatsubaThreshold || nb < 4)
+		mulSchoolbook(a, na, b, nb, out);
+	else if(nb <= (na + 1) / 2) // too lopsided to split both halves evenly
+		mulUnbalanced(a, na, b, nb, out);
+	else if(nb >= toom3Threshold && nb >= 9 && nb > 2 * ((na + 2) / 3))
+		mulToom3(a, na, b, nb, out);
+	else
+		mulKaratsuba(a, na, b, nb, out);
 }
 
-#endif
+//-------------------------------------------------------------
+// O(na * nb), fastest for small operands
+void BigInteger::mulSchoolbook(const limb* a, size_t na, const limb* b, size_t nb, limb* out)
+{
+	BIGINTEGER_STATS_SCOPE(Schoolbook, na);
+	fill(out, out + na + nb, 0);
+	for(size_t i=0; i<nb; ++i)
+	{
+		dlimb carry = 0;
+		dlimb currentLimb = b[i];
+
+		for(size_t j=0; j<na; ++j)
+		{
+			carry += currentLimb * a[j] + out[i+j];
+			out[i+j] = (limb) carry;
+			carry >>= 32;
+		}
+		out[i + na] = (limb) carry;
+	}
+}
+
+//-------------------------------------------------------------
+// na much larger than nb: multiply b by nb sized slices of a, so
+// each slice product is balanced enough for the faster tiers
+void BigInteger::mulUnbalanced(const limb* a, size_t na, const limb* b, size_t nb, limb* out)
+{
+	fill(out, out + na + nb, 0);
+	limbs slice(2 * nb);
+	for(size_t offset=0; offset<na; offset+=nb)
+	{
+		size_t len = min(nb, na - offset);
+		mul(b, nb, a + offset, len, &slice[0]);
+		addInto(out + offset, na + nb - offset, &slice[0], nb + len);
+	}
+}
+
+//-------------------------------------------------------------
+// a = a1 * B^h + a0, b = b1 * B^h + b0, three half size products:
+// a * b = a1b1 * B^2h + ((a0 + a1)(b0 + b1) - a0b0 - a1b1) * B^h + a0b0
+void BigInteger::mulKaratsuba(const limb* a, size_t na, const limb* b, size_t nb, limb* out)
+{
+	BIGINTEGER_STATS_SCOPE(Karatsuba, na);
+	size_t h = (na + 1) / 2; // nb > h is guaranteed by mul
+
+	limbs sa(h + 1), sb(h + 1);
+	copy(a, a + h, sa.begin());
+	copy(b, b + h, sb.begin());
+	sa[h] = addInto(&sa[0], h, a + h, na - h);
+	sb[h] = addInto(&sb[0], h, b + h, nb - h);
+
+	// the three products write to disjoint buffers, so they may run in parallel
+	limbs mid(2 * h + 2);
+	TaskGroup group(forkable(nb));
+	group.run([=] { mul(a, h, b, h, out); }); // a0b0 in out[0..2h)
+	group.run([=] { mul(a + h, na - h, b + h, nb - h, out + 2 * h); }); // a1b1 in out[2h..na+nb)
+	mul(&sa[0], h + 1, &sb[0], h + 1, &mid[0]);
+	group.wait();
+
+	subInto(&mid[0], mid.size(), out, 2 * h);
+	subInto(&mid[0], mid.size(), out + 2 * h, na + nb - 2 * h);
+
+	addInto(out + h, na + nb - h, &mid[0], significant(&mid[0], mid.size()));
+}
+
+//-------------------------------------------------------------
+// Toom-Cook-3 with Bodrato's evaluation and interpolation sequence:
+// split into thirds, evaluate at 0, 1, -1, -2 and infinity, five
+// third size products, then interpolate back to the five coefficients
+void BigInteger::mulToom3(const limb* a, size_t na, const limb* b, size_t nb, limb* out)
+{
+	BIGINTEGER_STATS_SCOPE(Toom3, na);
+	size_t k = (na + 2) / 3; // nb > 2k is guaranteed by mul
+
+	BigInteger a0, a1, a2, b0, b1, b2;
+	a0.number.assign(a, a + k); trim(a0.number);
+	a1.number.assign(a + k, a + 2 * k); trim(a1.number);
+	a2.number.assign(a + 2 * k, a + na); trim(a2.number);
+	b0.number.assign(b, b + k); trim(b0.number);
+	b1.number.assign(b + k, b + 2 * k); trim(b1.number);
+	b2.number.assign(b + 2 * k, b + nb); trim(b2.number);
+
+	// evaluation
+	BigInteger pt = a0 + a2, qt = b0 + b2;
+	BigInteger p1 = pt + a1, q1 = qt + b1;
+	BigInteger pm1 = pt - a1, qm1 = qt - b1;
+	BigInteger pm2 = pm1 + a2, qm2 = qm1 + b2;
+	pm2 = pm2 + pm2 - a0;
+	qm2 = qm2 + qm2 - b0;
+
+	// pointwise products, these recurse back into mul; each result is
+	// sized here so a forked task only fills in its limbs
+	BigInteger r0, r1, rm1, rm2, rinf;
+	BigInteger* products[] = { &r0, &r1, &rm1, &rm2, &rinf };
+	const BigInteger* factors[][2] = { { &a0, &b0 }, { &p1, &q1 }, { &pm1, &qm1 }, { &pm2, &qm2 }, { &a2, &b2 } };
+	TaskGroup group(forkable(nb));
+	for(size_t i=0; i<5; ++i)
+	{
+		const limbs& x = factors[i][0]->number;
+		const limbs& y = factors[i][1]->number;
+		if(x.empty() || y.empty())
+			continue;
+		products[i]->number.resize(x.size() + y.size());
+		products[i]->sign = (factors[i][0]->sign != factors[i][1]->sign);
+		limb* o = products[i]->number.data();
+		group.run([&x, &y, o] { mul(x.data(), x.size(), y.data(), y.size(), o); });
+	}
+	group.wait();
+	for(size_t i=0; i<5; ++i)
+		trim(products[i]->number);
+
+	// interpolation, every division here is exact
+	BigInteger r3 = rm2 - r1;
+	divideLimb(r3.number, 3, r3.number);
+	BigInteger c1 = r1 - rm1;
+	divideLimb(c1.number, 2, c1.number);
+	BigInteger c2 = rm1 - r0;
+	r3 = c2 - r3;
+	divideLimb(r3.number, 2, r3.number);
+	r3 = r3 + rinf + rinf;
+	c2 = c2 + c1 - rinf;
+	c1 = c1 - r3;
+
+	// the coefficients of a product of non-negative polynomials are non-negative
+	const BigInteger* coefficients[] = { &r0, &c1, &c2, &r3, &rinf };
+	fill(out, out + na + nb, 0);
+	for(size_t i=0; i<5; ++i)
+	{
+		const limbs& c = coefficients[i]->number;
+		if(! c.empty())
+			addInto(out + i * k, na + nb - i * k, &c[0], c.size());
+	}
+}
+
+//-------------------------------------------------------------
+typedef void (*MulKernel)(const BigInteger::limb*, size_t, const BigInteger::limb*, size_t, BigInteger::limb*);
+
+// average nanoseconds for one n by n limb product through kernel
+static double timeMultiply(MulKernel kernel, size_t n)
+{
+	vector<BigInteger::limb> a(n), b(n), out(2 * n);
+	unsigned int seed = 12345;
+	for(size_t i=0; i<n; ++i)
+	{
+		a[i] = seed = seed * 1103515245 + 12345;
+		b[i] = seed = seed * 1103515245 + 12345;
+	}
+
+	typedef chrono::steady_clock clock;
+	size_t reps = 0;
+	clock::time_point start = clock::now();
+	clock::duration elapsed;
+	do
+	{
+		kernel(&a[0], n, &b[0], n, &out[0]);
+		++reps;
+		elapsed = clock::now() - start;
+	} while(elapsed < chrono::milliseconds(5));
+
+	return chrono::duration<double, nano>(elapsed).count() / reps;
+}
+
+// first size (not below from) where faster beats slower twice in a row;
+// threshold is set to the size being timed so only the top recursion
+// level of either kernel differs
+static size_t crossover(size_t& threshold, MulKernel slower, MulKernel faster, const size_t* sizes, size_t count, size_t from)
+{
+	for(size_t i=0, wins=0; i<count; ++i)
+	{
+		if(sizes[i] < from)
+			continue;
+
+		threshold = sizes[i];
+		wins = (timeMultiply(faster, sizes[i]) < timeMultiply(slower, sizes[i])) ? wins + 1 : 0;
+		if(wins == 2)
+			return sizes[i - 1];
+	}
+	return sizes[count - 1];
+}
+
+//-------------------------------------------------------------
+// walks up the operand sizes, one tier at a time from the bottom
+void BigInteger::calibrate()
+{
+	static const size_t sizes[] = { 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768,
+		1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384, 24576, 32768 };
+	static const size_t count = sizeof(sizes) / sizeof(sizes[0]);
+	const size_t never = (size_t) -1;
+	BigIntegerThreadLimit serial(1); // time the tiers themselves, not the pool
+
+	toom3Threshold = nttThreshold = never;
+	karatsubaThreshold = crossover(karatsubaThreshold, mulSchoolbook, mulKaratsuba, sizes, count, 0);
+	toom3Threshold = crossover(toom3Threshold, mulKaratsuba, mulToom3, sizes, count, 2 * karatsubaThreshold);
+	nttThreshold = crossover(nttThreshold, mulToom3, mulNTT, sizes, count, toom3Threshold);
+}
+
+//-------------------------------------------------------------
+// number theoretic transform
+//-------------------------------------------------------------
+// Exact O(n log n) multiplication: the limb sequences are convolved
+// modulo two primes below 2^62 and the coefficients recombined with
+// the Chinese remainder theorem. A coefficient is at most
+// min(na, nb) * (2^32 - 1)^2, far below p1 * p2 ~ 2^124, so the result
+// is exact with no floating point involved.
+
+typedef unsigned long long u64;
+typedef unsigned __int128 u128;
+
+// arithmetic modulo one prime p = c * 2^k + 1, multiplication in
+// Montgomery form with R = 2^64
+class NttPrime
+{
+public:
+	NttPrime(u64 modulus, u64 generator)
+		: p(modulus), g(generator)
+	{
+		pinv = 1; // Newton iteration for p^-1 mod 2^64
+		for(int i=0; i<6; ++i)
+			pinv *= 2 - p * pinv;
+		pinv = 0 - pinv;
+		r2 = (u64) (((u128) 1 << 64) % p);
+		r2 = (u64) ((u128) r2 * r2 % p);
+	}
+
+	// a * b * R^-1 mod p
+	u64 mul(u64 a, u64 b) const
+	{
+		u128 t = (u128) a * b;
+		u64 m = (u64) t * pinv;
+		u64 u = (u64) ((t + (u128) m * p) >> 64);
+		return (u >= p) ? u - p : u;
+	}
+	u64 add(u64 a, u64 b) const
+	{
+		u64 s = a + b;
+		return (s >= p) ? s - p : s;
+	}
+	u64 sub(u64 a, u64 b) const
+	{
+		return (a >= b) ? a - b : a + p - b;
+	}
+	u64 toMont(u64 a) const { return mul(a, r2); }
+	u64 pow(u64 base, u64 e) const // base and result in Montgomery form
+	{
+		u64 res = toMont(1);
+		for(; e; e >>= 1, base = mul(base, base))
+			if(e & 1)
+				res = mul(res, base);
+		return res;
+	}
+
+	// twiddle factors for every transform length up to 2^logn, in Montgomery
+	// form: entries [m, 2m) hold w^0 .. w^(m-1) for a root w of order 2m, so a
+	// table for a longer transform has the shorter ones as its prefix
+	struct Twiddles
+	{
+		vector<u64> forward, inverse;
+	};
+
+	shared_ptr<const Twiddles> twiddles(int logn)
+	{
+		lock_guard<mutex> lock(tableMutex);
+		size_t n = (size_t) 1 << logn;
+		if(! table || table->forward.size() < n)
+		{
+			shared_ptr<Twiddles> grown = make_shared<Twiddles>();
+			grown->forward.resize(n);
+			grown->inverse.resize(n);
+			size_t have = 1;
+			if(table)
+			{
+				have = table->forward.size();
+				copy(table->forward.begin(), table->forward.end(), grown->forward.begin());
+				copy(table->inverse.begin(), table->inverse.end(), grown->inverse.begin());
+			}
+			for(size_t m=have; m<n; m<<=1)
+			{
+				u64 w = pow(toMont(g), (p - 1) / (2 * m));
+				u64 wi = pow(w, 2 * m - 1); // w^-1
+				u64 cur = toMont(1), curi = cur;
+				for(size_t j=0; j<m; ++j)
+				{
+					grown->forward[m + j] = cur;
+					grown->inverse[m + j] = curi;
+					cur = mul(cur, w);
+					curi = mul(curi, wi);
+				}
+			}
+			table = grown;
+		}
+		return table;
+	}
+
+	// decimation in frequency: natural order in, bit reversed order out.
+	// in parallel the first stage is split into chunks, after which the
+	// two halves are independent transforms of half the length
+	void forward(u64* a, size_t n, const u64* w) const
+	{
+		if(! forkable(n / transformGrain))
+		{
+			for(size_t len=n/2; len>=1; len>>=1)
+				for(size_t i=0; i<n; i+=2*len)
+					for(size_t j=0; j<len; ++j)
+					{
+						u64 u = a[i+j], v = a[i+j+len];
+						a[i+j] = add(u, v);
+						a[i+j+len] = mul(sub(u, v), w[len + j]);
+					}
+			return;
+		}
+
+		size_t len = n / 2;
+		parallelFor(len, BigInteger::parallelThreshold * transformGrain, [=](size_t begin, size_t end)
+		{
+			for(size_t j=begin; j<end; ++j)
+			{
+				u64 u = a[j], v = a[j+len];
+				a[j] = add(u, v);
+				a[j+len] = mul(sub(u, v), w[len + j]);
+			}
+		});
+		TaskGroup group(true);
+		group.run([=] { forward(a + len, len, w); });
+		forward(a, len, w);
+		group.wait();
+	}
+
+	// decimation in time: bit reversed order in, natural order out, unscaled;
+	// split like forward in reverse
+	void inverse(u64* a, size_t n, const u64* w) const
+	{
+		if(! forkable(n / transformGrain))
+		{
+			for(size_t len=1; len<n; len<<=1)
+				for(size_t i=0; i<n; i+=2*len)
+					for(size_t j=0; j<len; ++j)
+					{
+						u64 u = a[i+j], v = mul(a[i+j+len], w[len + j]);
+						a[i+j] = add(u, v);
+						a[i+j+len] = sub(u, v);
+					}
+			return;
+		}
+
+		size_t len = n / 2;
+		TaskGroup group(true);
+		group.run([=] { inverse(a + len, len, w); });
+		inverse(a, len, w);
+		group.wait();
+		parallelFor(len, BigInteger::parallelThreshold * transformGrain, [=](size_t begin, size_t end)
+		{
+			for(size_t j=begin; j<end; ++j)
+			{
+				u64 u = a[j], v = mul(a[j+len], w[len + j]);
+				a[j] = add(u, v);
+				a[j+len] = sub(u, v);
+			}
+		});
+	}
+
+	// cyclic convolution of a and b mod p, left in a; inputs are plain
+	// residues, the Montgomery factors of the twiddles cancel out
+	void convolve(vector<u64>& a, vector<u64>& b, bool square, int logn)
+	{
+		size_t n = a.size();
+		shared_ptr<const Twiddles> w = twiddles(logn);
+
+		u64* x = &a[0];
+		const u64* y = square ? x : &b[0];
+		size_t grain = BigInteger::parallelThreshold * transformGrain;
+
+		TaskGroup group(true);
+		if(! square)
+			group.run([&] { forward(&b[0], n, &w->forward[0]); });
+		forward(x, n, &w->forward[0]);
+		group.wait();
+		parallelFor(n, grain, [=](size_t begin, size_t end)
+		{
+			for(size_t i=begin; i<end; ++i)
+				x[i] = mul(x[i], y[i]); // now carries an extra R^-1
+		});
+		inverse(x, n, &w->inverse[0]);
+
+		// scale by n^-1 and put back the R lost in the pointwise products
+		u64 scale = mul(pow(toMont(n % p), p - 2), r2);
+		parallelFor(n, grain, [=](size_t begin, size_t end)
+		{
+			for(size_t i=begin; i<end; ++i)
+				x[i] = mul(x[i], scale);
+		});
+	}
+
+	// transform elements per limb of parallelThreshold that make a task worth forking
+	static const size_t transformGrain = 8;
+
+	u64 p, g, pinv, r2;
+private:
+	mutex tableMutex;
+	shared_ptr<const Twiddles> table;
+};
+
+static NttPrime& nttPrime1()
+{
+	static NttPrime prime(4601552919265804289ULL, 3); // 4087 * 2^50 + 1
+	return prime;
+}
+
+static NttPrime& nttPrime2()
+{
+	static NttPrime prime(4595360469778169857ULL, 5); // 8163 * 2^49 + 1
+	return prime;
+}
+
+//-------------------------------------------------------------
+// O((na + nb) log(na + nb)) product through two modular convolutions
+void BigInteger::mulNTT(const limb* a, size_t na, const limb* b, size_t nb, limb* out)
+{
+	BIGINTEGER_STATS_SCOPE(NTT, na);
+	NttPrime& p1 = nttPrime1();
+	NttPrime& p2 = nttPrime2();
+	bool square = (a == b && na == nb);
+
+	int logn = 0;
+	while(((size_t) 1 << logn) < na + nb)
+		++logn;
+	size_t n = (size_t) 1 << logn;
+
+	// the passes share the second operand's buffer unless they run in parallel
+	bool parallel = forkable(nb);
+	vector<u64> r1(n), fa(n), fb1(square ? 0 : n), fb2((square || ! parallel) ? 0 : n);
+	vector<u64>* buffers[][2] = { { &r1, &fb1 }, { &fa, parallel ? &fb2 : &fb1 } };
+	NttPrime* primes[] = { &p1, &p2 };
+	auto pass = [&](int k)
+	{
+		vector<u64>& x = *buffers[k][0];
+		vector<u64>& y = *buffers[k][1];
+		fill(x.begin(), x.end(), 0);
+		copy(a, a + na, x.begin());
+		if(! square)
+		{
+			fill(y.begin(), y.end(), 0);
+			copy(b, b + nb, y.begin());
+		}
+		primes[k]->convolve(x, y, square, logn);
+	};
+	TaskGroup group(parallel);
+	group.run([&] { pass(0); });
+	pass(1);
+	group.wait();
+
+	// c = r1 + p1 * ((r2 - r1) * p1^-1 mod p2), then carry into base 2^32;
+	// the digits t are independent, only the carry is sequential
+	u64 inv = p2.pow(p2.toMont(p1.p % p2.p), p2.p - 2); // p1^-1 in Montgomery form
+	u64* x = &fa[0];
+	const u64* y = &r1[0];
+	parallelFor(na + nb, parallelThreshold * NttPrime::transformGrain, [=, &p2](size_t begin, size_t end)
+	{
+		for(size_t i=begin; i<end; ++i)
+			x[i] = p2.mul(p2.sub(x[i], y[i] % p2.p), inv);
+	});
+	u128 carry = 0;
+	for(size_t i=0; i<na+nb; ++i)
+	{
+		carry += r1[i] + (u128) fa[i] * p1.p;
+		out[i] = (limb) carry;
+		carry >>= 32;
+	}
+}
+
+//-------------------------------------------------------------
+// division
+//-------------------------------------------------------------
+size_t BigInteger::burnikelZieglerThreshold = 80;
+
+// copies n[from..to) (clamped to n) without leading zeros
+static BigInteger::limbs slice(const BigInteger::limbs& n, size_t from, size_t to)
+{
+	to = min(to, n.size());
+	if(from >= to)
+		return BigInteger::limbs();
+
+	BigInteger::limbs part(n.begin() + from, n.begin() + to);
+	while(! part.empty() && part.back() == 0)
+		part.pop_back();
+	return part;
+}
+
+// high * B^h + low, where low has at most h limbs
+static BigInteger::limbs join(const BigInteger::limbs& high, const BigInteger::limbs& low, size_t h)
+{
+	if(high.empty())
+		return low;
+
+	BigInteger::limbs n(h + high.size());
+	copy(low.begin(), low.end(), n.begin());
+	copy(high.begin(), high.end(), n.begin() + h);
+	return n;
+}
+
+//-------------------------------------------------------------
+// shifts a magnitude left by bits
+BigInteger::limbs BigInteger::shiftLeft(const limbs& n, size_t bits)
+{
+	if(n.empty())
+		return limbs();
+
+	size_t whole = bits / 32, part = bits % 32;
+	limbs res(n.size() + whole + 1);
+	for(size_t i=0; i<n.size(); ++i)
+	{
+		dlimb v = (dlimb) n[i] << part;
+		res[i + whole] |= (limb) v;
+		res[i + whole + 1] = (limb) (v >> 32);
+	}
+
+	trim(res);
+	return res;
+}
+
+//-------------------------------------------------------------
+// shifts a magnitude right by bits, dropping the bits shifted out
+BigInteger::limbs BigInteger::shiftRight(const limbs& n, size_t bits)
+{
+	size_t whole = bits / 32, part = bits % 32;
+	if(whole >= n.size())
+		return limbs();
+
+	limbs res(n.size() - whole);
+	for(size_t i=0; i<res.size(); ++i)
+	{
+		dlimb v = n[i + whole];
+		if(i + whole + 1 < n.size())
+			v |= (dlimb) n[i + whole + 1] << 32;
+		res[i] = (limb) (v >> part);
+	}
+
+	trim(res);
+	return res;
+}
+
+//-------------------------------------------------------------
+// divides a magnitude by a single limb, returns the remainder
+BigInteger::limb BigInteger::divideLimb(const limbs& n, limb d, limbs& q)
+{
+	q.resize(n.size());
+	dlimb rem = 0;
+	for(size_t i=n.size(); i-->0; )
+	{
+		dlimb cur = (rem << 32) | n[i];
+		q[i] = (limb) (cur / d);
+		rem = cur % d;
+	}
+
+	trim(q);
+	return (limb) rem;
+}
+
+//-------------------------------------------------------------
+// divides two magnitudes, picking the algorithm by size
+void BigInteger::divide(const limbs& n, const limbs& d, limbs& q, limbs& r)
+{
+	BIGINTEGER_STATS_SCOPE(Divide, n.size());
+	if(d.empty())
+		throw domain_error("BigInteger: division by zero");
+
+	if(compare(n, d) < 0)
+	{
+		q.clear();
+		r = n;
+	}
+	else if(d.size() == 1)
+	{
+		limb rem = divideLimb(n, d[0], q);
+		r.assign(rem != 0, rem);
+	}
+	else if(d.size() < burnikelZieglerThreshold || n.size() - d.size() < burnikelZieglerThreshold)
+		divKnuth(n, d, q, r);
+	else
+		divBurnikelZiegler(n, d, q, r);
+}
+
+//-------------------------------------------------------------
+// Knuth's algorithm D (TAOCP vol. 2, 4.3.1), O(d * (n - d));
+// needs n >= d and at least two limbs in d
+void BigInteger::divKnuth(const limbs& n, const limbs& d, limbs& q, limbs& r)
+{
+	size_t len = d.size(), m = n.size() - len;
+	int s = __builtin_clz(d.back()); // normalize so the top bit of d is set
+
+	limbs vn = shiftLeft(d, s);
+	limbs un = shiftLeft(n, s);
+	un.resize(n.size() + 1);
+
+	q.assign(m + 1, 0);
+	for(size_t j=m+1; j-->0; )
+	{
+		// estimate the quotient limb from the top two limbs, off by at most 2
+		dlimb num = ((dlimb) un[j+len] << 32) | un[j+len-1];
+		dlimb qhat = num / vn[len-1];
+		dlimb rhat = num % vn[len-1];
+		while((qhat >> 32) || qhat * vn[len-2] > ((rhat << 32) | un[j+len-2]))
+		{
+			--qhat;
+			rhat += vn[len-1];
+			if(rhat >> 32)
+				break;
+		}
+
+		// un[j..j+len] -= qhat * vn
+		dlimb carry = 0;
+		limb borrow = 0;
+		for(size_t i=0; i<len; ++i)
+		{
+			dlimb p = qhat * vn[i] + carry;
+			carry = p >> 32;
+			dlimb t = (dlimb) un[i+j] - (limb) p - borrow;
+			un[i+j] = (limb) t;
+			borrow = (limb) (t >> 63);
+		}
+		dlimb t = (dlimb) un[j+len] - carry - borrow;
+		un[j+len] = (limb) t;
+
+		if(t >> 63) // qhat was one too big, add vn back
+		{
+			--qhat;
+			carry = 0;
+			for(size_t i=0; i<len; ++i)
+			{
+				carry += (dlimb) un[i+j] + vn[i];
+				un[i+j] = (limb) carry;
+				carry >>= 32;
+			}
+			un[j+len] += (limb) carry;
+		}
+		q[j] = (limb) qhat;
+	}
+
+	un.resize(len);
+	trim(un);
+	r = shiftRight(un, s);
+	trim(q);
+}
+
+//-------------------------------------------------------------
+// Burnikel and Ziegler's recursive division, "Fast Recursive Division"
+// (MPI-I-98-1-022), which turns a long division into half size
+// multiplications so it inherits the fast multiplication tiers.
+// d is padded to n = j * 2^k limbs with j below the threshold and its
+// top bit set, then the dividend is divided n limbs at a time
+void BigInteger::divBurnikelZiegler(const limbs& n, const limbs& d, limbs& q, limbs& r)
+{
+	size_t m = 1;
+	while(m * burnikelZieglerThreshold <= d.size())
+		m <<= 1;
+	size_t blockLen = (d.size() + m - 1) / m * m;
+
+	size_t sigma = (blockLen - d.size()) * 32 + __builtin_clz(d.back());
+	limbs b = shiftLeft(d, sigma);
+	limbs a = shiftLeft(n, sigma);
+
+	// one spare bit at the top keeps the leading block below b
+	size_t bits = a.size() * 32 - __builtin_clz(a.back());
+	size_t blocks = max((size_t) 2, (bits + 1 + blockLen * 32 - 1) / (blockLen * 32));
+
+	q.assign((blocks - 1) * blockLen, 0);
+	limbs z = slice(a, (blocks - 2) * blockLen, blocks * blockLen);
+	for(size_t i=blocks-1; i-->0; )
+	{
+		limbs qi;
+		div2n1n(z, b, blockLen, qi, r);
+		copy(qi.begin(), qi.end(), q.begin() + i * blockLen);
+
+		if(i > 0)
+			z = join(r, slice(a, (i - 1) * blockLen, i * blockLen), blockLen);
+	}
+
+	trim(q);
+	r = shiftRight(r, sigma);
+}
+
+//-------------------------------------------------------------
+// a < b * B^n, b has n limbs with its top bit set
+void BigInteger::div2n1n(const limbs& a, const limbs& b, size_t n, limbs& q, limbs& r)
+{
+	if(n % 2 == 1 || n < burnikelZieglerThreshold)
+	{
+		divide(a, b, q, r);
+		return;
+	}
+
+	size_t h = n / 2;
+	limbs q1, q2, r1;
+	div3n2n(slice(a, h, a.size()), b, h, q1, r1);
+	div3n2n(join(r1, slice(a, 0, h), h), b, h, q2, r);
+	q = join(q1, q2, h);
+	trim(q);
+}
+
+//-------------------------------------------------------------
+// a < b * B^h, b has 2h limbs with its top bit set
+void BigInteger::div3n2n(const limbs& a, const limbs& b, size_t h, limbs& q, limbs& r)
+{
+	limbs a12 = slice(a, h, a.size());
+	limbs b1 = slice(b, h, 2 * h);
+	limbs r1;
+
+	if(compare(slice(a, 2 * h, a.size()), b1) < 0)
+		div2n1n(a12, b1, h, q, r1);
+	else // the top halves match, so the quotient is B^h - 1
+	{
+		q.assign(h, 0xFFFFFFFF);
+		r1 = add(subtract(a12, join(b1, limbs(), h)), b1);
+	}
+
+	// the estimate q is at most 2 too big
+	limbs d = multiply(q, slice(b, 0, h));
+	limbs t = join(r1, slice(a, 0, h), h);
+	trim(t);
+	while(compare(t, d) < 0)
+	{
+		t = add(t, b);
+		q = subtract(q, limbs(1, 1));
+	}
+	r = subtract(t, d);
+}
+
+//-------------------------------------------------------------
+// shifts and bitwise operations
+//-------------------------------------------------------------
+static size_t bitLength(const BigInteger::limbs& n)
+{
+	return n.empty() ? 0 : 32 * n.size() - __builtin_clz(n.back());
+}
+
+static bool testBit(const BigInteger::limbs& n, size_t i)
+{
+	return i / 32 < n.size() && (n[i / 32] >> (i % 32)) & 1;
+}
+
+size_t BigInteger::bitLength() const
+{
+	return ::bitLength(number);
+}
+
+// -m is ~(m - 1) in two's complement; below the lowest 1 bit of m that
+// is 0, at it 1, and above it the bits of m inverted
+bool BigInteger::testBit(size_t i) const
+{
+	if(! sign)
+		return ::testBit(number, i);
+	size_t low = 0;
+	while(number[low] == 0)
+		++low;
+	low = 32 * low + __builtin_ctz(number[low]);
+	return i == low || (i > low && ! ::testBit(number, i));
+}
+
+size_t BigInteger::popcount() const
+{
+	size_t count = 0;
+	for(size_t i=0; i<number.size(); ++i)
+		count += __builtin_popcount(number[i]);
+	return count;
+}
+
+//-------------------------------------------------------------
+// shifts the magnitude in place, from the top down so no limb is read
+// after it has been written
+BigInteger& BigInteger::operator <<= (size_t bits)
+{
+	if(number.empty())
+		return (*this);
+
+	size_t whole = bits / 32, part = bits % 32, n = number.size();
+	number.resize(n + whole + 1);
+	limb* d = number.data();
+	d[n + whole] = part ? d[n - 1] >> (32 - part) : 0;
+	for(size_t i=n-1; i>0; --i)
+		d[i + whole] = (d[i] << part) | (part ? d[i - 1] >> (32 - part) : 0);
+	d[whole] = d[0] << part;
+	fill(d, d + whole, 0);
+	trim(number);
+	return (*this);
+}
+//-------------------------------------------------------------
+// floor division by 2^bits: a -ve number whose shifted out bits are not
+// all 0 moves one further from zero
+BigInteger& BigInteger::operator >>= (size_t bits)
+{
+	size_t whole = bits / 32, part = bits % 32, n = number.size();
+	if(whole >= n)
+	{
+		number.clear();
+		if(sign)
+			addWordInPlace(number, 1);
+		return (*this);
+	}
+
+	limb* d = number.data();
+	bool inexact = sign && (any_of(d, d + whole, [](limb x) { return x != 0; }) || (d[whole] & ((1ULL << part) - 1)) != 0);
+	for(size_t i=0; i+whole<n; ++i)
+		d[i] = (d[i + whole] >> part) | (part && i + whole + 1 < n ? d[i + whole + 1] << (32 - part) : 0);
+	number.resize(n - whole);
+	trim(number);
+	if(inexact)
+		addWordInPlace(number, 1);
+	return (*this);
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator << (size_t bits) const
+{
+	BigInteger res;
+	res.number.reserve(number.size() + bits / 32 + 1);
+	res = (*this);
+	return res <<= bits;
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator >> (size_t bits) const
+{
+	BigInteger res = (*this);
+	return res >>= bits;
+}
+
+//-------------------------------------------------------------
+// a op b on the two's complement forms in one pass. -m is ~(m - 1), so
+// each -ve operand streams a borrow through its limbs and is inverted,
+// and a -ve result is turned back into a magnitude as ~r + 1. one limb
+// past the longer operand holds only sign bits, which is enough room
+// for the carry
+template<class Op>
+BigInteger BigInteger::bitwise(const BigInteger& a, const BigInteger& b, Op op)
+{
+	const limb extendA = a.sign ? ~0U : 0, extendB = b.sign ? ~0U : 0;
+	const limb extendR = op(extendA, extendB);
+	size_t na = a.number.size(), nb = b.number.size(), n = max(na, nb) + 1;
+
+	BigInteger res;
+	res.number.resize(n);
+	limb borrowA = a.sign, borrowB = b.sign, carry = extendR & 1;
+	for(size_t i=0; i<n; ++i)
+	{
+		limb x = (i < na) ? a.number[i] : 0, y = (i < nb) ? b.number[i] : 0;
+		limb tx = (x - borrowA) ^ extendA, ty = (y - borrowB) ^ extendB;
+		borrowA &= (x == 0);
+		borrowB &= (y == 0);
+		dlimb v = (dlimb) (op(tx, ty) ^ extendR) + carry;
+		res.number[i] = (limb) v;
+		carry = (limb) (v >> 32);
+	}
+	trim(res.number);
+	res.sign = (extendR != 0); // a -ve result is never 0
+	return res;
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator & (const BigInteger& b) const
+{
+	return bitwise((*this), b, [](limb x, limb y) { return x & y; });
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator | (const BigInteger& b) const
+{
+	return bitwise((*this), b, [](limb x, limb y) { return x | y; });
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator ^ (const BigInteger& b) const
+{
+	return bitwise((*this), b, [](limb x, limb y) { return x ^ y; });
+}
+//-------------------------------------------------------------
+BigInteger& BigInteger::operator &= (const BigInteger& b)
+{
+	(*this) = (*this) & b;
+	return (*this);
+}
+//-------------------------------------------------------------
+BigInteger& BigInteger::operator |= (const BigInteger& b)
+{
+	(*this) = (*this) | b;
+	return (*this);
+}
+//-------------------------------------------------------------
+BigInteger& BigInteger::operator ^= (const BigInteger& b)
+{
+	(*this) = (*this) ^ b;
+	return (*this);
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::operator ~() const // -n - 1
+{
+	BigInteger res = -(*this);
+	return res.advance(-1);
+}
+
+//-------------------------------------------------------------
+// number theory
+//-------------------------------------------------------------
+// the 64 bits of n starting at bit from
+static unsigned long long bitsAt(const BigInteger::limbs& n, size_t from)
+{
+	unsigned long long w = 0;
+	size_t i = from / 32, part = from % 32;
+	for(size_t k=0; k<3 && i+k<n.size(); ++k)
+	{
+		unsigned __int128 v = (unsigned __int128) n[i + k] << (32 * k);
+		w |= (unsigned long long) (v >> part);
+	}
+	return w;
+}
+
+//-------------------------------------------------------------
+// left to right binary powering, squarings go through the same tiers
+BigInteger::limbs BigInteger::power(const limbs& base, unsigned long long exponent)
+{
+	limbs res = fromInt(1);
+	for(int i=63 - __builtin_clzll(exponent | 1); i>=0; --i)
+	{
+		res = multiply(res, res);
+		if((exponent >> i) & 1)
+			res = multiply(res, base);
+	}
+	return res;
+}
+
+BigInteger pow(const BigInteger& base, unsigned long long exponent)
+{
+	BigInteger res;
+	res.number = BigInteger::power(base.number, exponent);
+	res.sign = base.sign && (exponent & 1) && ! res.number.empty();
+	return res;
+}
+
+//-------------------------------------------------------------
+size_t BigInteger::montgomeryThreshold = 160;
+
+// Montgomery multiplication (CIOS) modulo an odd m of n limbs; values
+// are kept as a * 2^(32n) mod m, padded to n limbs
+class BigInteger::Montgomery
+{
+	limbs m;
+	size_t n;
+	limb minv; // -1/m mod 2^32
+public:
+	Montgomery(const limbs& modulus) : m(modulus), n(modulus.size())
+	{
+		limb inv = 1;
+		for(int i=0; i<5; ++i) // Newton's iteration doubles the correct low bits
+			inv *= 2 - m[0] * inv;
+		minv = 0 - inv;
+	}
+	limbs enter(const limbs& x) const
+	{
+		limbs q, r;
+		divide(shiftLeft(x, 32 * n), m, q, r);
+		r.resize(n, 0);
+		return r;
+	}
+	limbs leave(const limbs& x) const
+	{
+		limbs one(n, 0);
+		one[0] = 1;
+		limbs r = mul(x, one);
+		trim(r);
+		return r;
+	}
+	limbs one() const
+	{
+		return enter(fromInt(1));
+	}
+	limbs mul(const limbs& a, const limbs& b) const
+	{
+		limbs t(n + 2, 0);
+		for(size_t i=0; i<n; ++i)
+		{
+			dlimb c = 0;
+			for(size_t j=0; j<n; ++j)
+			{
+				c += t[j] + (dlimb) a[j] * b[i];
+				t[j] = (limb) c;
+				c >>= 32;
+			}
+			c += t[n];
+			t[n] = (limb) c;
+			t[n + 1] = (limb) (c >> 32);
+
+			// add u * m so the low limb cancels, then drop it
+			limb u = t[0] * minv;
+			c = ((dlimb) u * m[0] + t[0]) >> 32;
+			for(size_t j=1; j<n; ++j)
+			{
+				c += t[j] + (dlimb) u * m[j];
+				t[j - 1] = (limb) c;
+				c >>= 32;
+			}
+			c += t[n];
+			t[n - 1] = (limb) c;
+			t[n] = t[n + 1] + (limb) (c >> 32);
+		}
+
+		// t < 2m, one subtraction brings it below m
+		t.resize(n + 1);
+		if(t[n] != 0 || simd().compareN(t.data(), m.data(), n) >= 0)
+			simd().subN(t.data(), t.data(), m.data(), n, 0);
+		t.resize(n);
+		return t;
+	}
+};
+
+//-------------------------------------------------------------
+// Barrett reduction modulo m of n limbs with mu = B^(2n) / m, so each
+// reduction is two multiplications on the fast tiers
+class BigInteger::Barrett
+{
+	limbs m, mu;
+	size_t n;
+public:
+	Barrett(const limbs& modulus) : m(modulus), n(modulus.size())
+	{
+		limbs r;
+		divide(shiftLeft(fromInt(1), 64 * n), m, mu, r);
+	}
+	limbs enter(const limbs& x) const { return x; }
+	limbs leave(const limbs& x) const { return x; }
+	limbs one() const { return fromInt(1); }
+	limbs mul(const limbs& a, const limbs& b) const
+	{
+		limbs x = multiply(a, b); // below m^2
+		limbs q = slice(multiply(slice(x, n - 1, x.size()), mu), n + 1, 2 * n + 2);
+		subtractInPlace(x, multiply(q, m));
+		while(compare(x, m) >= 0) // at most twice
+			subtractInPlace(x, m);
+		return x;
+	}
+};
+
+//-------------------------------------------------------------
+// sliding window exponentiation, the window grows with the exponent
+template<class Reducer>
+static BigInteger::limbs powWindowed(const Reducer& red, const BigInteger::limbs& base, const BigInteger::limbs& exponent)
+{
+	size_t bits = bitLength(exponent);
+	size_t w = bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : bits > 7 ? 2 : 1;
+
+	// base^1, base^3, ..., base^(2^w - 1)
+	vector<BigInteger::limbs> odd(1 << (w - 1));
+	odd[0] = red.enter(base);
+	if(odd.size() > 1)
+	{
+		BigInteger::limbs square = red.mul(odd[0], odd[0]);
+		for(size_t i=1; i<odd.size(); ++i)
+			odd[i] = red.mul(odd[i - 1], square);
+	}
+
+	BigInteger::limbs acc = red.one();
+	bool first = true; // acc is still one, skip the squarings
+	for(size_t top=bits; top>0; )
+	{
+		if(! testBit(exponent, top - 1))
+		{
+			acc = red.mul(acc, acc);
+			--top;
+			continue;
+		}
+
+		// the longest window of at most w bits below top that ends in a 1
+		size_t low = top > w ? top - w : 0;
+		while(! testBit(exponent, low))
+			++low;
+		size_t value = 0;
+		for(size_t i=top; i-->low; )
+		{
+			if(! first)
+				acc = red.mul(acc, acc);
+			value = 2 * value + testBit(exponent, i);
+		}
+		acc = first ? odd[value / 2] : red.mul(acc, odd[value / 2]);
+		first = false;
+		top = low;
+	}
+	return red.leave(acc);
+}
+
+BigInteger powmod(const BigInteger& base, const BigInteger& exponent, const BigInteger& modulus)
+{
+	typedef BigInteger::limbs limbs;
+	if(modulus.number.empty())
+		throw domain_error("BigInteger: powmod by zero");
+	if(exponent.sign)
+		throw domain_error("BigInteger: powmod with a negative exponent");
+
+	const limbs& m = modulus.number;
+	limbs q, b;
+	BigInteger::divide(base.number, m, q, b);
+	if(base.sign && ! b.empty())
+		b = BigInteger::subtract(m, b); // least non-negative residue
+
+	BigInteger res;
+	if(m.size() == 1 && m[0] == 1)
+		return res; // everything is 0 mod 1
+	if(exponent.number.empty())
+		res.number = BigInteger::fromInt(1);
+	else if((m[0] & 1) && m.size() < BigInteger::montgomeryThreshold)
+		res.number = powWindowed(BigInteger::Montgomery(m), b, exponent.number);
+	else
+		res.number = powWindowed(BigInteger::Barrett(m), b, exponent.number);
+	return res;
+}
+
+//-------------------------------------------------------------
+// floor of the k-th root by Newton's iteration from above. the start
+// comes from the root of the top half of the digits, so the full
+// precision iteration only needs a few steps
+BigInteger::limbs BigInteger::root(const limbs& n, unsigned int k)
+{
+	size_t bits = ::bitLength(n);
+	if(bits <= k)
+		return n.empty() ? limbs() : fromInt(1); // 1 <= n < 2^k
+
+	size_t rootBits = (bits + k - 1) / k; // the root is below 2^rootBits
+	limbs x;
+	if(rootBits <= 64)
+		x = shiftLeft(fromInt(1), rootBits);
+	else
+	{
+		size_t half = rootBits / 2;
+		x = root(shiftRight(n, (size_t) k * half), k);
+		addWordInPlace(x, 1);
+		x = shiftLeft(x, half);
+	}
+
+	// x' = ((k - 1) x + n / x^(k - 1)) / k decreases until it reaches the root
+	limbs kMinus1 = fromInt(k - 1);
+	for(;;)
+	{
+		limbs q, r, y;
+		divide(n, power(x, k - 1), q, r);
+		addInPlace(q, multiply(x, kMinus1));
+		divideLimb(q, k, y);
+		if(compare(y, x) >= 0)
+			return x;
+		x = std::move(y);
+	}
+}
+
+BigInteger iroot(const BigInteger& n, unsigned int k)
+{
+	if(k == 0)
+		throw domain_error("BigInteger: zeroth root");
+	if(n.sign && k % 2 == 0)
+		throw domain_error("BigInteger: even root of a negative number");
+
+	BigInteger res;
+	res.number = BigInteger::root(n.number, k);
+	res.sign = n.sign;
+	return res;
+}
+
+BigInteger isqrt(const BigInteger& n)
+{
+	return iroot(n, 2);
+}
+
+//-------------------------------------------------------------
+// Lehmer's gcd: the leading 62 bits of a and b run Euclid's algorithm
+// on machine words, and the collected quotients are applied to the
+// full numbers in one pass, saving most of the long divisions
+BigInteger::limbs BigInteger::gcdLehmer(limbs a, limbs b)
+{
+	if(compare(a, b) < 0)
+		a.swap(b);
+
+	while(! b.empty())
+	{
+		size_t bits = ::bitLength(a);
+		if(bits <= 64)
+		{
+			unsigned long long x = lowWord(a), y = lowWord(b);
+			while(y != 0)
+			{
+				unsigned long long t = x % y;
+				x = y;
+				y = t;
+			}
+			return fromInt(x);
+		}
+
+		long long x = (long long) (bitsAt(a, bits - 62) & ((1ULL << 62) - 1));
+		long long y = (long long) (bitsAt(b, bits - 62) & ((1ULL << 62) - 1));
+		long long A = 1, B = 0, C = 0, D = 1;
+		// the quotient is certain while it is the same at both ends of
+		// the range the discarded low bits allow
+		while(y + C != 0 && y + D != 0)
+		{
+			long long q = (x + A) / (y + C);
+			if(q != (x + B) / (y + D))
+				break;
+			long long t = A - q * C; A = C; C = t;
+			t = B - q * D; B = D; D = t;
+			t = x - q * y; x = y; y = t;
+		}
+
+		if(B == 0)
+		{
+			// no quotient was certain, take one full Euclidean step
+			limbs q, r;
+			divide(a, b, q, r);
+			a.swap(b);
+			b.swap(r);
+			continue;
+		}
+
+		// a, b = A a + B b, C a + D b in one pass; both stay non-negative
+		limbs na(a.size()), nb(a.size());
+		__int128 c1 = 0, c2 = 0;
+		for(size_t i=0; i<a.size(); ++i)
+		{
+			limb bi = i < b.size() ? b[i] : 0;
+			c1 += (__int128) A * a[i] + (__int128) B * bi;
+			c2 += (__int128) C * a[i] + (__int128) D * bi;
+			na[i] = (limb) c1;
+			nb[i] = (limb) c2;
+			c1 >>= 32; // arithmetic shift, the carries may be -ve
+			c2 >>= 32;
+		}
+		trim(na);
+		trim(nb);
+		a.swap(na);
+		b.swap(nb);
+	}
+	return a;
+}
+
+BigInteger gcd(const BigInteger& a, const BigInteger& b)
+{
+	BigInteger res;
+	res.number = BigInteger::gcdLehmer(a.number, b.number);
+	return res;
+}
+
+BigInteger lcm(const BigInteger& a, const BigInteger& b)
+{
+	if(a == 0 || b == 0)
+		return BigInteger();
+	return (a / gcd(a, b) * b).absolute();
+}
+
+//-------------------------------------------------------------
+size_t BigInteger::radixThreshold = 30;
+
+//-------------------------------------------------------------
+// parses len decimal digits into a magnitude. long strings are split
+// in half at a power 10^(9 * 2^level) and the halves joined with one
+// multiplication, O(M(n) log n) overall
+BigInteger::limbs BigInteger::fromString(const char* s, size_t len)
+{
+	BIGINTEGER_STATS_SCOPE(Parse, len / 9 + 1);
+	if(len > 9 * radixThreshold)
+	{
+		size_t level = 0;
+		while(((size_t) 18 << level) < len)
+			++level;
+		size_t k = (size_t) 9 << level; // low digits, fewer than len
+		limbs n = multiply(fromString(s, len - k), powerOfTen(level));
+		addInPlace(n, fromString(s + len - k, k));
+		return n;
+	}
+
+	limbs n;
+	size_t chunk = len % 9; // leading partial chunk of < 9 digits
+	if(chunk == 0)
+		chunk = 9;
+
+	const SimdKernels& kernels = simd();
+	for(size_t indx=0; indx<len; indx+=chunk, chunk=9)
+	{
+		limb value = 0, scale = 1;
+		if(chunk == 9)
+		{
+			value = kernels.parse8(s + indx) * 10 + (s[indx + 8] - '0');
+			scale = 1000000000;
+		}
+		else
+		{
+			for(size_t k=indx; k<indx+chunk; ++k)
+			{
+				value = value * 10 + (s[k] - '0');
+				scale *= 10;
+			}
+		}
+
+		// n = n * scale + value
+		dlimb carry = value;
+		for(size_t i=0; i<n.size(); ++i)
+		{
+			carry += (dlimb) n[i] * scale;
+			n[i] = (limb) carry;
+			carry >>= 32;
+		}
+		if(carry != 0)
+			n.push_back( (limb) carry );
+	}
+
+	return n;
+}
+
+//-------------------------------------------------------------
+// converts unsigned long long to a magnitude
+BigInteger::limbs BigInteger::fromInt(unsigned long long n)
+{
+	limbs res;
+	while(n != 0)
+	{
+		res.push_back( (limb) n );
+		n >>= 32;
+	}
+	return res;
+}
+
+//-------------------------------------------------------------
+// the low 64 bits of a magnitude
+unsigned long long BigInteger::lowWord(const limbs& n)
+{
+	unsigned long long w = 0;
+	for(size_t i=0; i<n.size() && i<2; ++i)
+		w |= (unsigned long long) n[i] << (32 * i);
+	return w;
+}
+
+//-------------------------------------------------------------
+// converts a magnitude to a string of decimal digits
+string BigInteger::toString(const limbs& n)
+{
+	string res;
+	toDecimal(n, res);
+	return res;
+}
+
+//-------------------------------------------------------------
+// where toDecimal puts digits: straight into a string sized beforehand,
+// or through a block buffer into a stream buffer, along with the scratch
+// limbs every split reuses. long numbers are split as n = q * 10^k + r
+// with 10^k near the square root of n, then r is written with exactly k
+// digits; the split is a Barrett reduction by a reciprocal cached next
+// to 10^k, two products instead of a division
+class BigInteger::DecimalSink
+{
+	char* next; // where the next digits go
+	char* end; // of the block, unused for strings
+	string block;
+	streambuf* out;
+	bool leading; // only zeros reached out so far
+	bool failed;
+	limbs high, product; // scratch for split
+public:
+	explicit DecimalSink(char* at) : next(at), end(nullptr), out(nullptr), leading(false), failed(false) {}
+	DecimalSink(streambuf* sb, size_t room) : block(room, '0'), out(sb), leading(true), failed(false)
+	{
+		next = &block[0];
+		end = next + room;
+	}
+
+	// n < 10^k as exactly k digits, leaves n empty
+	void write(limbs& n, size_t k)
+	{
+		BIGINTEGER_STATS_SCOPE(Print, n.size());
+		if(n.size() >= max<size_t>(radixThreshold, 2))
+		{
+			size_t level = 0; // largest with 9 * 2^level < k, so n < 10^(18 * 2^level)
+			while(((size_t) 18 << level) < k)
+				++level;
+			size_t low = (size_t) 9 << level;
+			if(compare(n, powerOfTen(level)) < 0)
+			{
+				zeros(k - low);
+				write(n, low);
+				return;
+			}
+
+			limbs q;
+			split(n, level, q);
+			write(q, k - low);
+			write(n, low);
+			return;
+		}
+
+		size_t len = min(k, 10 * n.size()); // n < 2^(32 * size) < 10^len
+		zeros(k - len);
+		char* first = take(len);
+		char* p = first + len;
+
+		// peel off 9 decimal digits at a time, least significant first
+		const SimdKernels& kernels = simd();
+		while(! n.empty())
+		{
+			dlimb rem = 0;
+			for(size_t i=n.size(); i-->0; )
+			{
+				dlimb cur = (rem << 32) | n[i];
+				n[i] = (limb) (cur / 1000000000);
+				rem = cur % 1000000000;
+			}
+			trim(n);
+			if(p - first >= 9)
+			{
+				p -= 9;
+				p[0] = '0' + (char) (rem / 100000000);
+				kernels.format8((limb) (rem % 100000000), p + 1);
+			}
+			else // the leading digits, fewer than 9
+				for(; p>first; rem/=10)
+					*--p = '0' + (char) (rem % 10);
+		}
+		fill(first, p, '0');
+	}
+
+	// writes out what is buffered; false once out has failed
+	bool flush()
+	{
+		char* from = &block[0];
+		if(leading)
+		{
+			while(from < next && *from == '0')
+				++from;
+			leading = (from == next);
+		}
+		streamsize n = next - from;
+		if(n > 0 && out->sputn(from, n) != n)
+			failed = true;
+		next = &block[0];
+		return ! failed;
+	}
+	bool onlyZeros() const { return leading; }
+
+	// B^(2m) / 10^(9 * 2^level) for the m limbs of the power, cached
+	static const limbs& reciprocal(size_t level)
+	{
+		static mutex lock;
+		static vector< unique_ptr<limbs> > inverses;
+		lock_guard<mutex> guard(lock);
+
+		HeapScope heap;
+		while(inverses.size() <= level)
+		{
+			const limbs& d = powerOfTen(inverses.size());
+			limbs mu, r;
+			divide(shiftLeft(fromInt(1), 64 * d.size()), d, mu, r);
+			inverses.emplace_back( new limbs(std::move(mu)) );
+		}
+		return *inverses[level];
+	}
+private:
+	// len chars for the next digits, to be filled in any order
+	char* take(size_t len)
+	{
+		if(out != nullptr && (size_t) (end - next) < len)
+			flush();
+		char* p = next;
+		next += len;
+		return p;
+	}
+
+	void zeros(size_t len)
+	{
+		while(len > 0)
+		{
+			size_t n = (out != nullptr) ? min(len, block.size()) : len;
+			fill_n(take(n), n, '0');
+			len -= n;
+		}
+	}
+
+	// n = q * 10^(9 * 2^level) + r for n < 10^(18 * 2^level), leaves r in n.
+	// the estimate of q is at most 2 too small (HAC 14.42)
+	void split(limbs& n, size_t level, limbs& q)
+	{
+		const limbs& p = powerOfTen(level);
+		const limbs& mu = reciprocal(level);
+		size_t m = p.size();
+
+		size_t top = n.size() - (m - 1); // n / B^(m-1)
+		high.resize(top + mu.size());
+		mul(n.data() + m - 1, top, mu.data(), mu.size(), high.data());
+		trim(high);
+		q.assign(high.begin() + min(m + 1, high.size()), high.end());
+
+		if(! q.empty())
+		{
+			product.resize(q.size() + m);
+			mul(q.data(), q.size(), p.data(), m, product.data());
+			trim(product);
+			subtractInPlace(n, product);
+		}
+		while(compare(n, p) >= 0)
+		{
+			subtractInPlace(n, p);
+			addWordInPlace(q, 1);
+		}
+	}
+};
+
+//-------------------------------------------------------------
+void BigInteger::toDecimal(const limbs& n, string& out)
+{
+	size_t bits = n.empty() ? 0 : 32 * n.size() - __builtin_clz(n.back());
+	size_t digits = bits * 30103 / 100000 + 1; // bits * log10(2), rounded up; one too many at most
+
+	size_t at = out.size();
+	out.resize(at + digits);
+	limbs x = n;
+	DecimalSink(&out[at]).write(x, digits);
+	if(digits > 1 && out[at] == '0')
+		out.erase(at, 1);
+}
+
+//-------------------------------------------------------------
+bool BigInteger::toDecimal(const limbs& n, streambuf* out)
+{
+	size_t bits = n.empty() ? 0 : 32 * n.size() - __builtin_clz(n.back());
+	size_t digits = bits * 30103 / 100000 + 1;
+
+	// a leaf takes up to 10 digits per limb in one piece
+	DecimalSink sink(out, min(digits, max<size_t>(1 << 16, 10 * max<size_t>(radixThreshold, 2))));
+	limbs x = n;
+	sink.write(x, digits);
+	if(! sink.flush())
+		return false;
+	return ! sink.onlyZeros() || out->sputc('0') != streambuf::traits_type::eof();
+}
+
+//-------------------------------------------------------------
+// 10^(9 * 2^level) by repeated squaring, built once and shared by
+// every thread
+const BigInteger::limbs& BigInteger::powerOfTen(size_t level)
+{
+	static mutex lock;
+	static vector< unique_ptr<limbs> > powers; // entries never move once made
+	lock_guard<mutex> guard(lock);
+
+	HeapScope heap;
+	while(powers.size() <= level)
+	{
+		limbs next = powers.empty() ? fromInt(1000000000) : multiply(*powers.back(), *powers.back());
+		powers.emplace_back( new limbs(std::move(next)) );
+	}
+	return *powers[level];
+}
+
+//-------------------------------------------------------------
+// binary format
+//-------------------------------------------------------------
+// A record is a 16 byte header followed by the limbs of the magnitude,
+// everything little endian:
+//
+//	bytes 0-3	"BIGI"
+//	byte 4	format version, 1
+//	byte 5	flags, bit 0 set if -ve
+//	bytes 6-7	zero
+//	bytes 8-15	limb count
+//
+// The top limb is never zero and zero is never -ve, so every number has
+// exactly one record. Records are a multiple of 4 bytes long, so records
+// stored back to back in an aligned buffer keep their limbs aligned.
+static const char recordMagic[4] = { 'B', 'I', 'G', 'I' };
+static const unsigned char recordVersion = 1;
+static const size_t recordHeader = 16;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static const bool bigEndianHost = true;
+#else
+static const bool bigEndianHost = false;
+#endif
+
+static void writeHeader(unsigned char* p, size_t n, bool negative)
+{
+	memcpy(p, recordMagic, 4);
+	p[4] = recordVersion;
+	p[5] = negative ? 1 : 0;
+	p[6] = p[7] = 0;
+	for(int i=0; i<8; ++i)
+		p[8 + i] = (unsigned char) ((unsigned long long) n >> (8 * i));
+}
+
+// checks a header and returns the limb count it announces
+static unsigned long long readHeader(const unsigned char* p, bool& negative)
+{
+	if(memcmp(p, recordMagic, 4) != 0)
+		throw invalid_argument("BigInteger: not a serialized number");
+	if(p[4] != recordVersion)
+		throw invalid_argument("BigInteger: unsupported format version");
+	if((p[5] & ~1) != 0 || p[6] != 0 || p[7] != 0)
+		throw invalid_argument("BigInteger: corrupt header");
+
+	unsigned long long n = 0;
+	for(int i=8; i-->0; )
+		n = (n << 8) | p[8 + i];
+	negative = (p[5] & 1) != 0;
+	return n;
+}
+
+// limbs to and from little endian bytes
+static void storeLimbs(unsigned char* p, const BigInteger::limb* a, size_t n)
+{
+	if(! bigEndianHost)
+	{
+		memcpy(p, a, n * sizeof(BigInteger::limb));
+		return;
+	}
+	for(size_t i=0; i<n; ++i)
+		for(int k=0; k<4; ++k)
+			p[4 * i + k] = (unsigned char) (a[i] >> (8 * k));
+}
+
+static void loadLimbs(BigInteger::limb* a, const unsigned char* p, size_t n)
+{
+	if(! bigEndianHost)
+	{
+		memcpy(a, p, n * sizeof(BigInteger::limb));
+		return;
+	}
+	for(size_t i=0; i<n; ++i)
+		a[i] = p[4 * i] | (p[4 * i + 1] << 8) | (p[4 * i + 2] << 16) | ((BigInteger::limb) p[4 * i + 3] << 24);
+}
+
+static void checkNormalized(const BigInteger::limbs& n, bool negative)
+{
+	if(n.empty() ? negative : n.back() == 0)
+		throw invalid_argument("BigInteger: number is not normalized");
+}
+
+//-------------------------------------------------------------
+size_t BigInteger::serializedSize() const
+{
+	return recordHeader + number.size() * sizeof(limb);
+}
+//-------------------------------------------------------------
+void BigInteger::serialize(void* out) const
+{
+	unsigned char* p = (unsigned char*) out;
+	writeHeader(p, number.size(), sign);
+	storeLimbs(p + recordHeader, number.data(), number.size());
+}
+//-------------------------------------------------------------
+string BigInteger::serialize() const
+{
+	string out(serializedSize(), '\0');
+	serialize(&out[0]);
+	return out;
+}
+//-------------------------------------------------------------
+void BigInteger::serialize(ostream& os) const
+{
+	unsigned char header[recordHeader];
+	writeHeader(header, number.size(), sign);
+	os.write((const char*) header, recordHeader);
+	if(! bigEndianHost)
+		os.write((const char*) number.data(), number.size() * sizeof(limb));
+	else
+	{
+		string limbBytes(number.size() * sizeof(limb), '\0');
+		storeLimbs((unsigned char*) &limbBytes[0], number.data(), number.size());
+		os << limbBytes;
+	}
+}
+//-------------------------------------------------------------
+BigInteger BigInteger::deserialize(const void* data, size_t size, size_t* used)
+{
+	const unsigned char* p = (const unsigned char*) data;
+	if(size < recordHeader)
+		throw invalid_argument("BigInteger: truncated number");
+	bool negative;
+	unsigned long long n = readHeader(p, negative);
+	if(n > (size - recordHeader) / sizeof(limb))
+		throw invalid_argument("BigInteger: truncated number");
+
+	BigInteger res;
+	res.number.resize((size_t) n);
+	loadLimbs(res.number.data(), p + recordHeader, (size_t) n);
+	checkNormalized(res.number, negative);
+	res.sign = negative;
+	if(used != nullptr)
+		*used = res.serializedSize();
+	return res;
+}
+//-------------------------------------------------------------
+// reads the header first, then the limbs straight into place; the
+// stream's failbit is set on a short read
+BigInteger BigInteger::deserialize(istream& is)
+{
+	unsigned char header[recordHeader];
+	if(! is.read((char*) header, recordHeader))
+		throw invalid_argument("BigInteger: truncated number");
+	bool negative;
+	unsigned long long n = readHeader(header, negative);
+
+	BigInteger res;
+	const size_t chunk = 1 << 20; // limbs, so a corrupt count cannot make us allocate it all up front
+	for(unsigned long long have=0; have<n; )
+	{
+		size_t step = (size_t) min<unsigned long long>(chunk, n - have);
+		res.number.resize((size_t) have + step);
+		limb* at = res.number.data() + have;
+		if(! is.read((char*) at, step * sizeof(limb)))
+			throw invalid_argument("BigInteger: truncated number");
+		if(bigEndianHost)
+			loadLimbs(at, (const unsigned char*) at, step); // loads each limb before overwriting it
+		have += step;
+	}
+	checkNormalized(res.number, negative);
+	res.sign = negative;
+	return res;
+}
+
+//-------------------------------------------------------------
+// views
+//-------------------------------------------------------------
+BigIntegerView::BigIntegerView(const BigInteger& n)
+	: digits(n.number.data()), len(n.number.size()), sign(n.sign)
+{
+}
+//-------------------------------------------------------------
+BigIntegerView::BigIntegerView(const void* data, size_t size, size_t* used)
+{
+	const unsigned char* p = (const unsigned char*) data;
+	if(bigEndianHost)
+		throw domain_error("BigIntegerView: records can only be read in place on little endian hosts");
+	if((reinterpret_cast<size_t>(p) & (sizeof(limb) - 1)) != 0)
+		throw invalid_argument("BigIntegerView: record is not 4 byte aligned");
+	if(size < recordHeader)
+		throw invalid_argument("BigInteger: truncated number");
+	unsigned long long n = readHeader(p, sign);
+	if(n > (size - recordHeader) / sizeof(limb))
+		throw invalid_argument("BigInteger: truncated number");
+
+	digits = reinterpret_cast<const limb*>(p + recordHeader);
+	len = (size_t) n;
+	if(len == 0 ? sign : digits[len - 1] == 0)
+		throw invalid_argument("BigInteger: number is not normalized");
+	if(used != nullptr)
+		*used = serializedSize();
+}
+//-------------------------------------------------------------
+size_t BigIntegerView::serializedSize() const
+{
+	return recordHeader + len * sizeof(limb);
+}
+//-------------------------------------------------------------
+BigIntegerView::operator BigInteger() const
+{
+	BigInteger res;
+	res.number.assign(digits, digits + len);
+	res.sign = sign;
+	return res;
+}
+//-------------------------------------------------------------
+int BigIntegerView::compare(const BigIntegerView& a, const BigIntegerView& b)
+{
+	if(a.sign != b.sign)
+		return a.sign ? -1 : 1;
+	int c = compareMagnitude(a, b);
+	return a.sign ? -c : c;
+}
+//-------------------------------------------------------------
+int BigIntegerView::compareMagnitude(const BigIntegerView& a, const BigIntegerView& b)
+{
+	if(a.len != b.len)
+		return (a.len < b.len) ? -1 : 1;
+	return simd().compareN(a.digits, b.digits, a.len);
+}
+//-------------------------------------------------------------
+// a + b, or a - b if negateB, written once into out
+size_t BigIntegerView::sumInto(const BigIntegerView& a, const BigIntegerView& b, bool negateB, limb* out, bool& sign)
+{
+	bool bSign = (b.sign != negateB) && b.len != 0;
+	size_t n;
+	if(a.sign == bSign)
+	{
+		const BigIntegerView& longer = (a.len >= b.len) ? a : b;
+		const BigIntegerView& shorter = (a.len >= b.len) ? b : a;
+		BigInteger::dlimb carry = simd().addN(out, longer.digits, shorter.digits, shorter.len, 0);
+		size_t i = shorter.len;
+		for(; i<longer.len; ++i)
+		{
+			carry += longer.digits[i];
+			out[i] = (limb) carry;
+			carry >>= 32;
+		}
+		out[i] = (limb) carry;
+		n = i + 1;
+		sign = a.sign;
+	}
+	else
+	{
+		int c = compareMagnitude(a, b);
+		const BigIntegerView& larger = (c > 0) ? a : b;
+		const BigIntegerView& smaller = (c > 0) ? b : a;
+		BigInteger::limb borrow = simd().subN(out, larger.digits, smaller.digits, smaller.len, 0);
+		for(size_t i=smaller.len; i<larger.len; ++i)
+		{
+			limb x = larger.digits[i]; // out may be larger.digits
+			out[i] = x - borrow;
+			borrow = borrow && x == 0;
+		}
+		n = larger.len;
+		sign = (c > 0) ? a.sign : bSign;
+	}
+	n = significant(out, n);
+	sign = sign && n != 0;
+	return n;
+}
+//-------------------------------------------------------------
+size_t BigIntegerView::productInto(const BigIntegerView& a, const BigIntegerView& b, limb* out, bool& sign)
+{
+	sign = false;
+	if(a.len == 0 || b.len == 0)
+		return 0;
+	BigInteger::mul(a.digits, a.len, b.digits, b.len, out);
+	sign = (a.sign != b.sign);
+	return significant(out, a.len + b.len);
+}
+//-------------------------------------------------------------
+BigInteger BigIntegerView::sum(const BigIntegerView& a, const BigIntegerView& b, bool negateB)
+{
+	BigInteger res;
+	res.number.resize(max(a.len, b.len) + 1);
+	res.number.resize(sumInto(a, b, negateB, res.number.data(), res.sign));
+	return res;
+}
+//-------------------------------------------------------------
+BigInteger BigIntegerView::product(const BigIntegerView& a, const BigIntegerView& b)
+{
+	BigInteger res;
+	res.number.resize(a.len + b.len);
+	res.number.resize(productInto(a, b, res.number.data(), res.sign));
+	return res;
+}
+
+//-------------------------------------------------------------
+// arrays
+//-------------------------------------------------------------
+static unsigned int slotLength(size_t n)
+{
+	if(n > UINT_MAX)
+		throw length_error("BigIntegerArray: element too long");
+	return (unsigned int) n;
+}
+//-------------------------------------------------------------
+void BigIntegerArray::reserve(size_t count, size_t limbs)
+{
+	slots.reserve(count);
+	pool.reserve(limbs);
+}
+//-------------------------------------------------------------
+void BigIntegerArray::clear()
+{
+	pool.clear();
+	slots.clear();
+	garbage = 0;
+}
+//-------------------------------------------------------------
+bool BigIntegerArray::inPool(const BigIntegerView& n) const
+{
+	return n.len != 0 && n.digits >= pool.data() && n.digits < pool.data() + pool.size();
+}
+//-------------------------------------------------------------
+void BigIntegerArray::push_back(const BigIntegerView& n)
+{
+	if(inPool(n)) // the pool may move while growing
+	{
+		BigInteger copy(n);
+		push_back(copy);
+		return;
+	}
+
+	Slot s = { pool.size(), slotLength(n.len), n.sign };
+	pool.insert(pool.end(), n.digits, n.digits + n.len);
+	slots.push_back(s);
+}
+//-------------------------------------------------------------
+void BigIntegerArray::pop_back()
+{
+	const Slot& s = slots.back();
+	if(s.offset + s.length == pool.size())
+		pool.resize(s.offset);
+	else
+		garbage += s.length;
+	slots.pop_back();
+}
+//-------------------------------------------------------------
+// writes over the old value when n fits there or the element is last
+// in the pool, else appends n and leaves a gap; once gaps make up half
+// the pool it is compacted, so the cost stays amortized O(length of n)
+void BigIntegerArray::set(size_t i, const BigIntegerView& n)
+{
+	if(inPool(n))
+	{
+		BigInteger copy(n);
+		set(i, copy);
+		return;
+	}
+
+	Slot& s = slots[i];
+	unsigned int length = slotLength(n.len);
+	if(length <= s.length)
+		garbage += s.length - length;
+	else if(s.offset + s.length == pool.size())
+		pool.resize(s.offset + length);
+	else
+	{
+		garbage += s.length;
+		s.offset = pool.size();
+		pool.resize(pool.size() + length);
+	}
+	copy(n.digits, n.digits + n.len, pool.begin() + s.offset);
+	s.length = length;
+	s.sign = n.sign;
+
+	if(garbage > pool.size() / 2)
+		compact();
+}
+//-------------------------------------------------------------
+void BigIntegerArray::compact()
+{
+	vector<limb> fresh;
+	fresh.reserve(pool.size() - garbage);
+	for(size_t i=0; i<slots.size(); ++i)
+	{
+		Slot& s = slots[i];
+		size_t at = fresh.size();
+		fresh.insert(fresh.end(), pool.begin() + s.offset, pool.begin() + s.offset + s.length);
+		s.offset = at;
+	}
+	pool.swap(fresh);
+	garbage = 0;
+}
+//-------------------------------------------------------------
+template<class Bound, class F>
+void BigIntegerArray::transform(Bound bound, F f)
+{
+	vector<limb> fresh;
+	fresh.reserve(pool.size() - garbage + slots.size());
+	for(size_t i=0; i<slots.size(); ++i)
+	{
+		Slot& s = slots[i];
+		BigIntegerView v = view(s);
+		size_t at = fresh.size();
+		fresh.resize(at + bound(v));
+		bool sign;
+		size_t n = f(v, fresh.data() + at, sign);
+		fresh.resize(at + n);
+		s.offset = at;
+		s.length = slotLength(n);
+		s.sign = sign;
+	}
+	pool.swap(fresh);
+	garbage = 0;
+}
+//-------------------------------------------------------------
+void BigIntegerArray::add(const BigIntegerView& n)
+{
+	if(inPool(n))
+	{
+		BigInteger copy(n);
+		add(copy);
+		return;
+	}
+	transform([&](const BigIntegerView& v) { return max(v.len, n.len) + 1; },
+		[&](const BigIntegerView& v, limb* out, bool& sign) { return BigIntegerView::sumInto(v, n, false, out, sign); });
+}
+//-------------------------------------------------------------
+void BigIntegerArray::multiply(const BigIntegerView& n)
+{
+	if(inPool(n))
+	{
+		BigInteger copy(n);
+		multiply(copy);
+		return;
+	}
+	transform([&](const BigIntegerView& v) { return v.len + n.len; },
+		[&](const BigIntegerView& v, limb* out, bool& sign) { return BigIntegerView::productInto(v, n, out, sign); });
+}
+//-------------------------------------------------------------
+// each sum is written right after the previous one, which it reads
+void BigIntegerArray::prefixSums()
+{
+	vector<limb> fresh;
+	fresh.reserve(pool.size() - garbage + slots.size());
+	Slot last = { 0, 0, false };
+	for(size_t i=0; i<slots.size(); ++i)
+	{
+		Slot& s = slots[i];
+		size_t at = fresh.size();
+		fresh.resize(at + max(last.length, s.length) + 1);
+		BigIntegerView running(fresh.data() + last.offset, last.length, last.sign);
+		bool sign;
+		size_t n = BigIntegerView::sumInto(running, view(s), false, fresh.data() + at, sign);
+		fresh.resize(at + n);
+		s.offset = at;
+		s.length = slotLength(n);
+		s.sign = sign;
+		last = s;
+	}
+	pool.swap(fresh);
+	garbage = 0;
+}
+//-------------------------------------------------------------
+void BigIntegerArray::sort()
+{
+	std::sort(slots.begin(), slots.end(), [this](const Slot& a, const Slot& b)
+	{
+		return BigIntegerView::compare(view(a), view(b)) < 0;
+	});
+	compact();
+}
+//-------------------------------------------------------------
+size_t BigIntegerArray::minIndex() const
+{
+	size_t best = 0;
+	for(size_t i=1; i<slots.size(); ++i)
+		if(BigIntegerView::compare(view(slots[i]), view(slots[best])) < 0)
+			best = i;
+	return best; // 0, which is size(), if empty
+}
+//-------------------------------------------------------------
+size_t BigIntegerArray::maxIndex() const
+{
+	size_t best = 0;
+	for(size_t i=1; i<slots.size(); ++i)
+		if(BigIntegerView::compare(view(slots[i]), view(slots[best])) > 0)
+			best = i;
+	return best; // 0, which is size(), if empty
+}
+
+//-------------------------------------------------------------
+// products and sums of ranges
+//-------------------------------------------------------------
+// an empty number bound to the heap; a pool task may fill it while the
+// calling thread keeps using its own arena
+static BigInteger heapNumber()
+{
+	HeapScope heap;
+	return BigInteger();
+}
+
+// product of the magnitudes f[0..n), n >= 1. prefix[i] is the limbs of
+// f[0..i), and the range is split where half of its limbs lie on either
+// side, so the two halves come out about the same size
+static BigInteger productTree(const BigIntegerView* f, const size_t* prefix, size_t n)
+{
+	if(n == 1)
+		return (BigInteger) f[0];
+	if(n == 2)
+		return f[0] * f[1];
+
+	size_t half = prefix[0] + (prefix[n] - prefix[0]) / 2;
+	size_t mid = upper_bound(prefix + 1, prefix + n, half) - prefix;
+	mid = min(max<size_t>(mid, 1), n - 1);
+
+	BigInteger left = heapNumber();
+	TaskGroup group(forkable(prefix[n] - prefix[0]));
+	group.run([&] { left = productTree(f, prefix, mid); });
+	BigInteger right = productTree(f + mid, prefix + mid, n - mid);
+	group.wait();
+	return left * right;
+}
+
+BigInteger BigIntegerReduction::product(const BigIntegerView* factors, size_t n)
+{
+	vector<BigIntegerView> magnitudes;
+	vector<size_t> prefix(1, 0);
+	magnitudes.reserve(n);
+	prefix.reserve(n + 1);
+	bool negative = false;
+	for(size_t i=0; i<n; ++i)
+	{
+		if(factors[i].len == 0)
+			return BigInteger();
+		negative = (negative != factors[i].sign);
+		magnitudes.push_back(BigIntegerView(factors[i].digits, factors[i].len, false));
+		prefix.push_back(prefix.back() + factors[i].len);
+	}
+	if(n == 0)
+		return BigInteger(1);
+
+	BigInteger res;
+	if(currentBudget == nullptr && prefix.back() >= BigInteger::parallelThreshold && budgetThreads() > 1)
+		withBudget([&] { res = productTree(&magnitudes[0], &prefix[0], n); });
+	else
+		res = productTree(&magnitudes[0], &prefix[0], n);
+	res.sign = negative;
+	return res;
+}
+
+// packs as many consecutive words as fit into one 64 bit leaf before
+// building the tree, so small factors cost a machine multiply each
+BigInteger BigIntegerReduction::productOfWords(const unsigned long long* magnitudes, size_t n)
+{
+	vector<BigInteger> leaves;
+	unsigned long long acc = 1;
+	for(size_t i=0; i<n; ++i)
+	{
+		if(magnitudes[i] == 0)
+			return BigInteger();
+		if((u128) acc * magnitudes[i] >> 64)
+		{
+			leaves.push_back(BigInteger());
+			leaves.back().number = BigInteger::fromInt(acc);
+			acc = magnitudes[i];
+		}
+		else
+			acc *= magnitudes[i];
+	}
+	leaves.push_back(BigInteger());
+	leaves.back().number = BigInteger::fromInt(acc);
+
+	vector<BigIntegerView> views(leaves.begin(), leaves.end());
+	return product(&views[0], views.size());
+}
+
+//-------------------------------------------------------------
+// sum of t[0..n), in place into acc; ranges worth it are split in two
+// halves that are summed in parallel
+static void sumRange(BigInteger& acc, const BigIntegerView* t, size_t n, size_t limbs)
+{
+	if(n >= 2 && forkable(limbs))
+	{
+		size_t mid = n / 2;
+		BigInteger left = heapNumber();
+		TaskGroup group(true);
+		group.run([&] { sumRange(left, t, mid, limbs / 2); });
+		sumRange(acc, t + mid, n - mid, limbs - limbs / 2);
+		group.wait();
+		acc += left;
+		return;
+	}
+
+	for(size_t i=0; i<n; ++i)
+		BigIntegerReduction::accumulate(acc, t[i]);
+}
+
+void BigIntegerReduction::accumulate(BigInteger& acc, const BigIntegerView& term)
+{
+	size_t n = acc.number.size();
+	acc.number.resize(max(n, term.len) + 1);
+	BigIntegerView current(acc.number.data(), n, acc.sign); // sumInto may write over its own inputs
+	acc.number.resize(BigIntegerView::sumInto(current, term, false, acc.number.data(), acc.sign));
+}
+
+BigInteger BigIntegerReduction::sum(const BigIntegerView* terms, size_t n)
+{
+	size_t limbs = 0;
+	for(size_t i=0; i<n; ++i)
+		limbs += terms[i].len;
+
+	BigInteger res;
+	if(currentBudget == nullptr && limbs >= BigInteger::parallelThreshold && budgetThreads() > 1)
+		withBudget([&] { sumRange(res, terms, n, limbs); });
+	else
+		sumRange(res, terms, n, limbs);
+	return res;
+}
+
+// n words sum to less than 2^128
+BigInteger BigIntegerReduction::sumOfWords(const unsigned long long* magnitudes, size_t n)
+{
+	u128 total = 0;
+	for(size_t i=0; i<n; ++i)
+		total += magnitudes[i];
+
+	BigInteger res;
+	for(; total != 0; total >>= 32)
+		res.number.push_back((BigInteger::limb) total);
+	return res;
+}
+
+//-------------------------------------------------------------
+// factorials and binomials
+//-------------------------------------------------------------
+// the primes up to n by a sieve of Eratosthenes over the odd numbers,
+// one bit each
+static vector<unsigned int> primesUpTo(unsigned int n)
+{
+	vector<unsigned int> primes;
+	if(n < 2)
+		return primes;
+	primes.reserve((size_t) (1.26 * n / log((double) n)) + 1);
+	primes.push_back(2);
+	vector<bool> composite(n / 2 + 1); // entry i stands for 2i + 1
+	for(unsigned long long i=1; 2*i+1<=n; ++i)
+		if(! composite[i])
+		{
+			unsigned long long p = 2 * i + 1;
+			primes.push_back((unsigned int) p);
+			for(unsigned long long j=p*p/2; j<composite.size(); j+=p)
+				composite[j] = true;
+		}
+	return primes;
+}
+
+// exponent of the prime p in n!, by Legendre's formula
+static unsigned long long legendre(unsigned long long n, unsigned long long p)
+{
+	unsigned long long e = 0;
+	while(n >= p)
+	{
+		n /= p;
+		e += n;
+	}
+	return e;
+}
+
+// product of primes[i]^exponents[i] for the odd primes, the caller
+// shifts in the power of 2. the exponents are read a bit at a time from
+// the top as r = r^2 * (product of the primes with that bit set), so the
+// primes enter through product trees and the long multiplications are
+// squarings
+static BigInteger productOfPowers(const vector<unsigned int>& primes, const vector<unsigned long long>& exponents)
+{
+	unsigned long long bits = 0;
+	for(size_t i=1; i<primes.size(); ++i)
+		bits |= exponents[i];
+
+	BigInteger res(1);
+	vector<unsigned long long> factors;
+	for(int bit=63 - __builtin_clzll(bits | 1); bit>=0; --bit)
+	{
+		factors.clear();
+		for(size_t i=1; i<primes.size(); ++i)
+			if((exponents[i] >> bit) & 1)
+				factors.push_back(primes[i]);
+		res = res * res;
+		if(! factors.empty())
+			res *= BigIntegerReduction::productOfWords(factors.data(), factors.size());
+	}
+	return res;
+}
+
+BigInteger factorial(unsigned int n)
+{
+	BigInteger res;
+	if(n <= 20) // fits a word
+	{
+		unsigned long long f = 1;
+		for(unsigned int i=2; i<=n; ++i)
+			f *= i;
+		res.number = BigInteger::fromInt(f);
+		return res;
+	}
+
+	vector<unsigned int> primes = primesUpTo(n);
+	vector<unsigned long long> exponents(primes.size());
+	for(size_t i=0; i<primes.size(); ++i)
+		exponents[i] = legendre(n, primes[i]);
+	res = productOfPowers(primes, exponents);
+	res.number = BigInteger::shiftLeft(res.number, exponents[0]);
+	return res;
+}
+
+// small k take n (n - 1) ... (n - k + 1) / k! and need no sieve up to n;
+// otherwise the exponent of p is the one in n! less those in k! and
+// (n - k)!
+BigInteger binomial(unsigned long long n, unsigned long long k)
+{
+	if(k > n)
+		return BigInteger();
+	k = min(k, n - k);
+	if(k == 0)
+		return BigInteger(1);
+	if(k > UINT_MAX)
+		throw length_error("BigInteger: binomial too large");
+
+	if(n > UINT_MAX || k < n / 64)
+	{
+		vector<unsigned long long> falling(k);
+		for(unsigned long long i=0; i<k; ++i)
+			falling[i] = n - i;
+		return BigIntegerReduction::productOfWords(falling.data(), falling.size()) / factorial((unsigned int) k);
+	}
+
+	vector<unsigned int> primes = primesUpTo((unsigned int) n);
+	vector<unsigned long long> exponents(primes.size());
+	for(size_t i=0; i<primes.size(); ++i)
+		exponents[i] = legendre(n, primes[i]) - legendre(k, primes[i]) - legendre(n - k, primes[i]);
+	BigInteger res = productOfPowers(primes, exponents);
+	res.number = BigInteger::shiftLeft(res.number, exponents[0]);
+	return res;
+}
+
+BigInteger multinomial(const vector<unsigned int>& k)
+{
+	unsigned long long total = 0;
+	vector<unsigned int> parts; // largest first, 0 and 1 dropped
+	for(size_t i=0; i<k.size(); ++i)
+	{
+		total += k[i];
+		if(k[i] > 1)
+			parts.push_back(k[i]);
+	}
+	if(total > UINT_MAX)
+		throw length_error("BigInteger: multinomial too large");
+	sort(parts.begin(), parts.end(), greater<unsigned int>());
+	if(parts.size() == 1 && parts[0] == total)
+		return BigInteger(1);
+
+	vector<unsigned int> primes = primesUpTo((unsigned int) total);
+	vector<unsigned long long> exponents(primes.size());
+	for(size_t i=0; i<primes.size(); ++i)
+	{
+		exponents[i] = legendre(total, primes[i]);
+		for(size_t j=0; j<parts.size() && parts[j]>=primes[i]; ++j)
+			exponents[i] -= legendre(parts[j], primes[i]);
+	}
+	BigInteger res = productOfPowers(primes, exponents);
+	if(! primes.empty())
+		res.number = BigInteger::shiftLeft(res.number, exponents[0]);
+	return res;
+}
+
+BigInteger primorial(unsigned int n)
+{
+	vector<unsigned int> primes = primesUpTo(n);
+	vector<unsigned long long> words(primes.begin(), primes.end());
+	return BigIntegerReduction::productOfWords(words.data(), words.size());
+}
@@ -1,56 +1,552 @@
+#ifndef BIGINTEGER_H
+#define BIGINTEGER_H
+
 #include <string>
-#define MAX 10000 // for strings
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <iosfwd>
+#include <iterator>
+#include <type_traits>
 
 using namespace std;
 //-------------------------------------------------------------
+// bump allocator for limbs. while an arena is alive it is installed for
+// its thread, and numbers made on that thread take their limbs from it;
+// everything is released at once when the arena dies. arenas nest, the
+// innermost one wins. numbers made under an arena must not outlive it,
+// copy or assign the results to numbers made outside before it ends
+class BigIntegerArena
+{
+public:
+	explicit BigIntegerArena(size_t blockBytes = 1 << 16);
+	~BigIntegerArena();
+	BigIntegerArena(const BigIntegerArena&) = delete;
+	BigIntegerArena& operator = (const BigIntegerArena&) = delete;
+	void reset(); // drops every allocation but keeps the newest block for reuse
+	size_t bytesReserved() const; // total size of the blocks held
+	static BigIntegerArena* current(); // innermost arena of this thread, null if none
+private:
+	friend class LimbVector;
+	struct alignas(16) Block // padded to 32 bytes, so data() stays 16 byte aligned
+	{
+		Block* next;
+		size_t size; // in limbs
+		size_t used;
+		unsigned int* data() { return reinterpret_cast<unsigned int*>(this + 1); }
+	};
+	Block* head; // block being bumped, older ones follow
+	size_t blockLimbs; // size of the next block
+	BigIntegerArena* outer; // arena installed before this one
+	unsigned int* allocate(size_t n);
+	void deallocate(unsigned int* p, size_t n); // only the latest allocation gives space back
+	bool extend(unsigned int* p, size_t n, size_t m); // grows the latest allocation in place
+};
+//-------------------------------------------------------------
+// growable array of limbs with the subset of the vector interface the
+// kernels use. up to inlineLimbs live inside the object, bigger arrays
+// come from the arena installed when it was made, else from the heap.
+// a buffer never changes owner: moving or swapping between vectors of
+// different arenas copies the limbs, or a vector made outside an arena
+// would keep its memory after the arena is gone. that copy can throw
+// bad_alloc, so move assignment and swap are not noexcept
+class LimbVector
+{
+public:
+	typedef unsigned int limb;
+	static const size_t inlineLimbs = 2;
+private:
+	limb* buf;
+	size_t len;
+	size_t cap;
+	BigIntegerArena* arena; // owner of buf once it leaves local, null for the heap
+	limb local[inlineLimbs];
+public:
+	LimbVector() : buf(local), len(0), cap(inlineLimbs), arena(BigIntegerArena::current()) {}
+	explicit LimbVector(size_t n, limb value = 0);
+	LimbVector(const limb* first, const limb* last);
+	LimbVector(const LimbVector& v);
+	LimbVector(LimbVector&& v) noexcept; // keeps the arena of v
+	~LimbVector() { release(); }
+	LimbVector& operator = (const LimbVector& v);
+	LimbVector& operator = (LimbVector&& v); // copies if v lives in another arena
+	bool operator == (const LimbVector& v) const;
+	bool operator != (const LimbVector& v) const { return ! (*this == v); }
+
+	size_t size() const { return len; }
+	size_t capacity() const { return cap; }
+	bool empty() const { return len == 0; }
+	limb* data() { return buf; }
+	const limb* data() const { return buf; }
+	limb* begin() { return buf; }
+	const limb* begin() const { return buf; }
+	limb* end() { return buf + len; }
+	const limb* end() const { return buf + len; }
+	limb& operator [] (size_t i) { return buf[i]; }
+	const limb& operator [] (size_t i) const { return buf[i]; }
+	limb& back() { return buf[len - 1]; }
+	const limb& back() const { return buf[len - 1]; }
+
+	void reserve(size_t n) { if(n > cap) grow(n); }
+	void resize(size_t n, limb value = 0);
+	void assign(size_t n, limb value);
+	void assign(const limb* first, const limb* last);
+	void push_back(limb x) { if(len == cap) grow(2 * cap); buf[len++] = x; }
+	void pop_back() { --len; }
+	void clear() { len = 0; }
+	void swap(LimbVector& v); // copies if the two live in different arenas, unchanged if that throws
+private:
+	void grow(size_t n); // reallocates to hold at least n limbs
+	void release();
+};
+//-------------------------------------------------------------
+// caps the threads a product started on this thread may use while the
+// limit is alive, so callers sharing the pool do not oversubscribe the
+// machine; limits nest, the smallest one wins
+class BigIntegerThreadLimit
+{
+public:
+	explicit BigIntegerThreadLimit(unsigned maxThreads); // 1 keeps products on this thread
+	~BigIntegerThreadLimit();
+	BigIntegerThreadLimit(const BigIntegerThreadLimit&) = delete;
+	BigIntegerThreadLimit& operator = (const BigIntegerThreadLimit&) = delete;
+private:
+	unsigned outer; // limit installed before this one, 0 if none
+};
+//-------------------------------------------------------------
+// call counts, operand size histograms, ticks and allocations per
+// internal routine. they are only collected when BigInteger.cpp is built
+// with -DBIGINTEGER_STATS, which also prints them to stderr at exit;
+// otherwise the hooks compile away and every snapshot is zero
+struct BigIntegerStats
+{
+	enum Routine { Compare, Add, Subtract, Increment, Multiply, Schoolbook, Karatsuba, Toom3, NTT, Divide, Parse, Print };
+	static const int routines = Print + 1;
+	static const int sizeBuckets = 33; // bucket b holds operands of [2^(b-1), 2^b) limbs, bucket 0 empty ones
+
+	struct Counter
+	{
+		unsigned long long calls; // outermost calls, recursion into the same routine is not counted again
+		unsigned long long ticks; // time inside, CPU cycles on x86 and nanoseconds elsewhere
+		unsigned long long sizes[sizeBuckets]; // calls by the limbs of the larger operand
+	};
+	Counter routine[routines];
+	unsigned long long heapAllocations; // limb buffers taken from malloc or realloc
+	unsigned long long arenaAllocations; // limb buffers taken from a BigIntegerArena
+	unsigned long long allocatedBytes;
+
+	static bool enabled(); // true if built with BIGINTEGER_STATS
+	static BigIntegerStats snapshot(); // totals over all threads so far
+	static void reset();
+	static const char* name(Routine r);
+	void print(ostream& os) const; // a table of the routines that were called
+};
+template<unsigned Bits> class FixedInt;
+//-------------------------------------------------------------
 class BigInteger
 {
+	template<unsigned Bits> friend class FixedInt; // converts limb by limb
+	friend struct LazyEvaluator; // evaluates BigIntegerExpr.h trees in place
+	friend class BigIntegerView; // reads limbs in place
+	friend struct BigIntegerReduction; // builds product and sum trees
+public:
+	typedef unsigned int limb; // one base 2^32 digit
+	typedef unsigned long long dlimb; // wide enough for limb * limb + limb + limb
+	typedef LimbVector limbs; // little endian, no leading zero limbs, zero is empty
 private:
-	string number;
-	bool sign;
+	limbs number; // magnitude
+	bool sign; // true if -ve
 public:
 	BigInteger(); // empty constructor initializes zero
-	BigInteger(string s); // "string" constructor
-	BigInteger(string s, bool sin); // "string" constructor
+	BigInteger(const string& s); // "string" constructor
+	BigInteger(const string& s, bool sin); // "string" constructor
 	BigInteger(int n); // "int" constructor
-	void setNumber(string s);
-	const string& getNumber(); // retrieves the number
+	BigInteger(const BigInteger& b);
+	BigInteger(BigInteger&& b) noexcept; // steals the limbs of b, leaving it zero
+	void setNumber(const string& s); // parses the decimal digits of the magnitude
+	string getNumber() const; // retrieves the number (decimal digits, without sign)
 	void setSign(bool s);
-	const bool& getSign();
-	BigInteger absolute(); // returns the absolute value
-	void operator = (BigInteger b);
-	bool operator == (BigInteger b);
-	bool operator != (BigInteger b);
-	bool operator > (BigInteger b);
-	bool operator < (BigInteger b);
-	bool operator >= (BigInteger b);
-	bool operator <= (BigInteger b);
+	const bool& getSign() const;
+	BigInteger absolute() const; // returns the absolute value
+	void swap(BigInteger& b); // copies the limbs across arenas, see LimbVector
+	BigInteger& operator = (const BigInteger& b);
+	BigInteger& operator = (BigInteger&& b); // steals the limbs of b unless they live in another arena
+	bool operator == (const BigInteger& b) const;
+	bool operator != (const BigInteger& b) const;
+	bool operator > (const BigInteger& b) const;
+	bool operator < (const BigInteger& b) const;
+	bool operator >= (const BigInteger& b) const;
+	bool operator <= (const BigInteger& b) const;
 	BigInteger& operator ++(); // prefix
 	BigInteger  operator ++(int); // postfix
 	BigInteger& operator --(); // prefix
 	BigInteger  operator --(int); // postfix
-	BigInteger operator + (BigInteger b);
-	BigInteger operator - (BigInteger b);
-	BigInteger operator * (BigInteger b);
-	BigInteger operator / (BigInteger b);
-	BigInteger operator % (BigInteger b);
-	BigInteger& operator += (BigInteger b);
-	BigInteger& operator -= (BigInteger b);
-	BigInteger& operator *= (BigInteger b);
-	BigInteger& operator /= (BigInteger b);
-	BigInteger& operator %= (BigInteger b);
-	BigInteger& operator [] (int n);
-	BigInteger operator -(); // unary minus sign
-	operator string(); // for conversion from BigInteger to string
-private:
-	bool equals(BigInteger n1, BigInteger n2);
-	bool less(BigInteger n1, BigInteger n2);
-	bool greater(BigInteger n1, BigInteger n2);
-	string add(string number1, string number2);
-	string subtract(string number1, string number2);
-	string multiply(string n1, string n2);
-	pair<string, long long> divide(string n, long long den);
-	string toString(long long n);
-	long long toInt(string s);
+	BigInteger& advance(long long k); // adds k in place, cheap for small k
+	// the && overloads add into the left operand's limbs, so in
+	// a + b + c only a single buffer is allocated
+	BigInteger operator + (const BigInteger& b) const &;
+	BigInteger operator + (const BigInteger& b) &&;
+	BigInteger operator - (const BigInteger& b) const &;
+	BigInteger operator - (const BigInteger& b) &&;
+	BigInteger operator * (const BigInteger& b) const;
+	BigInteger operator / (const BigInteger& b) const;
+	BigInteger operator % (const BigInteger& b) const;
+	BigInteger& operator += (const BigInteger& b);
+	BigInteger& operator -= (const BigInteger& b);
+	BigInteger& operator *= (const BigInteger& b);
+	BigInteger& operator /= (const BigInteger& b);
+	BigInteger& operator %= (const BigInteger& b);
+	pair<BigInteger, BigInteger> divmod(const BigInteger& b) const; // quotient and remainder of one division
+	// fused (*this) += a * b and (*this) -= a * b, small products never
+	// materialize; see BigIntegerExpr.h to fuse whole expressions
+	BigInteger& addmul(const BigInteger& a, const BigInteger& b);
+	BigInteger& submul(const BigInteger& a, const BigInteger& b);
+	// shifts and bitwise operations see the two's complement form with
+	// sign bits running on forever, like the built-in types do: n >> k
+	// rounds toward -infinity and ~n is -n - 1. all are O(n) in the limbs
+	BigInteger operator << (size_t bits) const;
+	BigInteger operator >> (size_t bits) const;
+	BigInteger& operator <<= (size_t bits);
+	BigInteger& operator >>= (size_t bits);
+	BigInteger operator & (const BigInteger& b) const;
+	BigInteger operator | (const BigInteger& b) const;
+	BigInteger operator ^ (const BigInteger& b) const;
+	BigInteger& operator &= (const BigInteger& b);
+	BigInteger& operator |= (const BigInteger& b);
+	BigInteger& operator ^= (const BigInteger& b);
+	BigInteger operator ~() const;
+	size_t bitLength() const; // bits of the magnitude, 0 for zero
+	bool testBit(size_t i) const; // bit i of the two's complement form
+	size_t popcount() const; // 1 bits of the magnitude
+	BigInteger operator -() const &; // unary minus sign
+	BigInteger operator -() &&;
+	operator string() const; // for conversion from BigInteger to string
+	friend ostream& operator << (ostream& os, const BigInteger& n); // decimal, honours width and fill
+	friend istream& operator >> (istream& is, BigInteger& n); // optional sign then digits
+
+	// versioned binary format, little endian limbs after a 16 byte header;
+	// deserialize throws invalid_argument on anything but a whole valid
+	// record and sets *used to the bytes it took
+	size_t serializedSize() const;
+	void serialize(void* out) const; // writes serializedSize() bytes
+	string serialize() const;
+	void serialize(ostream& os) const;
+	static BigInteger deserialize(const void* data, size_t size, size_t* used = nullptr);
+	static BigInteger deserialize(istream& is);
+
+	// powers, roots, divisors and factorials, see the declarations after the class
+	friend BigInteger pow(const BigInteger& base, unsigned long long exponent);
+	friend BigInteger powmod(const BigInteger& base, const BigInteger& exponent, const BigInteger& modulus);
+	friend BigInteger iroot(const BigInteger& n, unsigned int k);
+	friend BigInteger gcd(const BigInteger& a, const BigInteger& b);
+	friend BigInteger factorial(unsigned int n);
+	friend BigInteger binomial(unsigned long long n, unsigned long long k);
+	friend BigInteger multinomial(const vector<unsigned int>& k);
+
+	// multiplication tiers, operand sizes are in limbs of the smaller factor
+	static size_t karatsubaThreshold; // schoolbook below this
+	static size_t toom3Threshold; // Karatsuba below this, Toom-Cook-3 from here on
+	static size_t nttThreshold; // Toom-Cook-3 below this, number theoretic transform from here on
+	static void calibrate(); // times the tiers on this machine and resets the thresholds
+	// products whose smaller factor has at least parallelThreshold limbs
+	// fork their sub-products and transforms over a shared thread pool;
+	// the result never depends on the number of threads
+	static void setThreads(unsigned n); // pool size counting the caller, 1 (the default) is serial; not while products run
+	static unsigned threads();
+	static size_t parallelThreshold;
+	static size_t burnikelZieglerThreshold; // divisor limbs, Knuth's algorithm D below this
+	static size_t montgomeryThreshold; // modulus limbs, powmod reduces odd moduli by Montgomery below this and Barrett above
+	static size_t radixThreshold; // limbs, decimal conversion is quadratic below this and divide and conquer above
+
+	// add, subtract, compare and digit conversion run on vectorized kernels
+	// picked from the CPU at startup: "avx2", "sse4.2" or "scalar"
+	static const char* simdLevel();
+	static bool setSimdLevel(const string& level); // false if unknown or unsupported here
+private:
+	static bool equals(const BigInteger& n1, const BigInteger& n2);
+	static bool less(const BigInteger& n1, const BigInteger& n2);
+	static bool greater(const BigInteger& n1, const BigInteger& n2);
+	void accumulate(const limbs& mag, bool negative); // (*this) += (-1)^negative * mag, in place
+	void mulAccumulate(const limbs& a, const limbs& b, bool negative); // (*this) += (-1)^negative * a * b
+	// magnitude kernels, operate on limbs only
+	static int compare(const limbs& n1, const limbs& n2);
+	static void trim(limbs& n);
+	static limbs add(const limbs& number1, const limbs& number2);
+	static limbs subtract(const limbs& number1, const limbs& number2);
+	static void addInPlace(limbs& acc, const limbs& n);
+	static void subtractInPlace(limbs& acc, const limbs& n); // acc must not be smaller
+	static void subtractFromInPlace(limbs& acc, const limbs& n); // acc = n - acc, n must not be smaller
+	static void addWordInPlace(limbs& acc, unsigned long long w);
+	static void subtractWordInPlace(limbs& acc, unsigned long long w); // acc must not be smaller
+	static limbs multiply(const limbs& n1, const limbs& n2);
+	// multiplies a[0..na) by b[0..nb) into out[0..na+nb), picking a tier by size
+	static void mul(const limb* a, size_t na, const limb* b, size_t nb, limb* out);
+	static void mulSchoolbook(const limb* a, size_t na, const limb* b, size_t nb, limb* out);
+	static void mulUnbalanced(const limb* a, size_t na, const limb* b, size_t nb, limb* out);
+	static void mulKaratsuba(const limb* a, size_t na, const limb* b, size_t nb, limb* out);
+	static void mulToom3(const limb* a, size_t na, const limb* b, size_t nb, limb* out);
+	static void mulNTT(const limb* a, size_t na, const limb* b, size_t nb, limb* out);
+	// divides n by d into quotient q and remainder r, picking an algorithm by size
+	static void divide(const limbs& n, const limbs& d, limbs& q, limbs& r);
+	static limb divideLimb(const limbs& n, limb d, limbs& q); // returns the remainder
+	static void divKnuth(const limbs& n, const limbs& d, limbs& q, limbs& r);
+	static void divBurnikelZiegler(const limbs& n, const limbs& d, limbs& q, limbs& r);
+	static void div2n1n(const limbs& a, const limbs& b, size_t n, limbs& q, limbs& r);
+	static void div3n2n(const limbs& a, const limbs& b, size_t h, limbs& q, limbs& r);
+	static limbs shiftLeft(const limbs& n, size_t bits);
+	static limbs shiftRight(const limbs& n, size_t bits);
+	template<class Op> static BigInteger bitwise(const BigInteger& a, const BigInteger& b, Op op); // a op b limb by limb
+	// conversions, only used at the I/O boundary
+	static limbs fromString(const char* s, size_t len); // len decimal digits, no sign
+	static limbs fromInt(unsigned long long n);
+	static unsigned long long lowWord(const limbs& n);
+	static string toString(const limbs& n);
+	static void toDecimal(const limbs& n, string& out); // appends the digits of n
+	static bool toDecimal(const limbs& n, streambuf* out); // writes them in blocks, false if out failed
+	static const limbs& powerOfTen(size_t level); // 10^(9 * 2^level), cached
+	class DecimalSink; // where toDecimal puts digits, with its scratch limbs
+	// number theory kernels
+	static limbs power(const limbs& base, unsigned long long exponent);
+	static limbs root(const limbs& n, unsigned int k); // floor of the k-th root
+	static limbs gcdLehmer(limbs a, limbs b);
+	class Montgomery; // modular multiplication contexts for powmod
+	class Barrett;
 };
 
+//-------------------------------------------------------------
+// read-only number whose limbs live elsewhere: in a BigInteger, or in a
+// serialized record, e.g. in a memory mapped file. comparisons, +, - and
+// * between views (and BigIntegers, which convert) read the limbs in
+// place; convert to a BigInteger for anything else. the memory must stay
+// mapped and unchanged while the view is used
+class BigIntegerView
+{
+public:
+	typedef BigInteger::limb limb;
+	BigIntegerView() : digits(nullptr), len(0), sign(false) {} // zero
+	BigIntegerView(const BigInteger& n);
+	// the record at data, which must be 4 byte aligned; throws like
+	// BigInteger::deserialize and sets *used to the bytes of the record
+	BigIntegerView(const void* data, size_t size, size_t* used = nullptr);
+	explicit operator BigInteger() const; // copies the limbs
+
+	const limb* data() const { return digits; } // magnitude, little endian
+	size_t size() const { return len; } // in limbs
+	bool getSign() const { return sign; } // true if -ve
+	size_t serializedSize() const;
+
+	static int compare(const BigIntegerView& a, const BigIntegerView& b); // -1, 0 or 1
+	friend BigInteger operator + (const BigIntegerView& a, const BigIntegerView& b);
+	friend BigInteger operator - (const BigIntegerView& a, const BigIntegerView& b);
+	friend BigInteger operator * (const BigIntegerView& a, const BigIntegerView& b);
+private:
+	friend class BigIntegerArray; // makes views of its pool
+	friend struct BigIntegerReduction;
+	BigIntegerView(const limb* d, size_t n, bool s) : digits(d), len(n), sign(s) {}
+	const limb* digits;
+	size_t len;
+	bool sign; // true if -ve
+	static int compareMagnitude(const BigIntegerView& a, const BigIntegerView& b);
+	// a + b (a - b if negateB) or a * b into out, which has room for the
+	// longest possible result; return the length and set sign. sumInto
+	// may write over the digits of a or b
+	static size_t sumInto(const BigIntegerView& a, const BigIntegerView& b, bool negateB, limb* out, bool& sign);
+	static size_t productInto(const BigIntegerView& a, const BigIntegerView& b, limb* out, bool& sign);
+	static BigInteger sum(const BigIntegerView& a, const BigIntegerView& b, bool negateB);
+	static BigInteger product(const BigIntegerView& a, const BigIntegerView& b);
+};
+
+// declared out here rather than as hidden friends so they also take
+// anything that converts to a view, such as BigIntegerArray elements
+inline bool operator == (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::compare(a, b) == 0; }
+inline bool operator != (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::compare(a, b) != 0; }
+inline bool operator < (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::compare(a, b) < 0; }
+inline bool operator > (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::compare(a, b) > 0; }
+inline bool operator <= (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::compare(a, b) <= 0; }
+inline bool operator >= (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::compare(a, b) >= 0; }
+inline BigInteger operator + (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::sum(a, b, false); }
+inline BigInteger operator - (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::sum(a, b, true); }
+inline BigInteger operator * (const BigIntegerView& a, const BigIntegerView& b) { return BigIntegerView::product(a, b); }
+
+//-------------------------------------------------------------
+// product and sum of a whole range through balanced trees. the range is
+// split where half of its limbs lie on either side, so each product pairs
+// operands of about the same size and reaches the fast tiers, where
+// folding with *= multiplies an ever longer product by small factors.
+// built-in integers are packed into machine words first. subtrees run in
+// parallel once BigInteger::setThreads has given the pool threads
+template<class It> BigInteger product(It first, It last); // 1 for an empty range
+template<class It> BigInteger sum(It first, It last); // 0 for an empty range
+template<class Range> BigInteger product(const Range& r) { return product(begin(r), end(r)); }
+template<class Range> BigInteger sum(const Range& r) { return sum(begin(r), end(r)); }
+
+// the non-template part of product and sum
+struct BigIntegerReduction
+{
+	static BigInteger product(const BigIntegerView* factors, size_t n);
+	static BigInteger sum(const BigIntegerView* terms, size_t n);
+	static BigInteger productOfWords(const unsigned long long* magnitudes, size_t n); // n >= 0, no sign
+	static BigInteger sumOfWords(const unsigned long long* magnitudes, size_t n);
+	static void accumulate(BigInteger& acc, const BigIntegerView& term); // acc += term, in place
+
+	// elements of a range are read as built-in integers, in place as
+	// views, or converted to BigIntegers first, whichever applies
+	enum Access { Words, InPlace, Converted };
+	template<class It> struct AccessOf
+	{
+		typedef typename iterator_traits<It>::value_type value;
+		typedef typename iterator_traits<It>::reference reference;
+		static const Access access = is_integral<value>::value ? Words
+			: (is_lvalue_reference<reference>::value && is_convertible<reference, BigIntegerView>::value) ? InPlace : Converted;
+	};
+
+	template<class T> static unsigned long long magnitude(T x, bool& negative)
+	{
+		negative = is_signed<T>::value && x < T();
+		return negative ? 0ULL - (unsigned long long) x : (unsigned long long) x;
+	}
+
+	template<class It>
+	static BigInteger reduce(It first, It last, bool multiply, integral_constant<Access, Words>)
+	{
+		vector<unsigned long long> positive, negative;
+		bool sign = false;
+		for(; first != last; ++first)
+		{
+			bool n;
+			unsigned long long m = magnitude(*first, n);
+			if(multiply)
+				sign = (sign != n);
+			(n && ! multiply ? negative : positive).push_back(m);
+		}
+		if(multiply)
+		{
+			BigInteger p = productOfWords(positive.data(), positive.size());
+			return sign ? -p : p;
+		}
+		return sumOfWords(positive.data(), positive.size()) - sumOfWords(negative.data(), negative.size());
+	}
+
+	template<class It>
+	static BigInteger reduce(It first, It last, bool multiply, integral_constant<Access, InPlace>)
+	{
+		vector<BigIntegerView> views;
+		for(; first != last; ++first)
+			views.push_back(BigIntegerView(*first));
+		return multiply ? product(views.data(), views.size()) : sum(views.data(), views.size());
+	}
+
+	template<class It>
+	static BigInteger reduce(It first, It last, bool multiply, integral_constant<Access, Converted>)
+	{
+		vector<BigInteger> values;
+		for(; first != last; ++first)
+			values.push_back(BigInteger(*first));
+		return reduce(values.begin(), values.end(), multiply, integral_constant<Access, InPlace>());
+	}
+};
+
+template<class It>
+BigInteger product(It first, It last)
+{
+	return BigIntegerReduction::reduce(first, last, true, integral_constant<BigIntegerReduction::Access, BigIntegerReduction::AccessOf<It>::access>());
+}
+
+template<class It>
+BigInteger sum(It first, It last)
+{
+	return BigIntegerReduction::reduce(first, last, false, integral_constant<BigIntegerReduction::Access, BigIntegerReduction::AccessOf<It>::access>());
+}
+
+//-------------------------------------------------------------
+// many numbers in one contiguous pool of limbs plus an index of offset,
+// length and sign per element, instead of a heap block per number.
+// elements read in place as views; storing a longer value into one moves
+// it to the end of the pool, and compact() closes the gaps left behind.
+// the bulk operations stream through the pool in index order and write a
+// fresh pool without gaps. any change invalidates views of the elements
+class BigIntegerArray
+{
+public:
+	typedef BigInteger::limb limb;
+	class Element;
+
+	BigIntegerArray() : garbage(0) {}
+	size_t size() const { return slots.size(); }
+	bool empty() const { return slots.empty(); }
+	size_t poolSize() const { return pool.size(); } // in limbs, gaps included
+	void reserve(size_t count, size_t limbs); // elements and their total limbs
+	void clear();
+	void push_back(const BigIntegerView& n);
+	void pop_back();
+	BigIntegerView operator [] (size_t i) const { return view(slots[i]); }
+	Element operator [] (size_t i);
+	void set(size_t i, const BigIntegerView& n); // in place if n fits where the old value was
+	void compact(); // lays the elements out again in index order
+
+	// bulk operations
+	void add(const BigIntegerView& n); // every element += n
+	void multiply(const BigIntegerView& n); // every element *= n
+	void prefixSums(); // element i becomes the sum of elements 0..i
+	void sort(); // ascending; the pool ends up in sorted order too
+	size_t minIndex() const; // first smallest element, size() if empty
+	size_t maxIndex() const; // first largest element, size() if empty
+private:
+	struct Slot
+	{
+		size_t offset; // into pool
+		unsigned int length; // in limbs
+		bool sign; // true if -ve
+	};
+	vector<limb> pool;
+	vector<Slot> slots;
+	size_t garbage; // limbs of pool no slot uses
+	BigIntegerView view(const Slot& s) const { return BigIntegerView(pool.data() + s.offset, s.length, s.sign); }
+	bool inPool(const BigIntegerView& n) const; // true if n reads our own limbs
+	// writes element by element into a new pool; f(view of old element,
+	// output limbs with room for bound(view), sign) returns the length
+	template<class Bound, class F> void transform(Bound bound, F f);
+};
+
+// what a[i] returns on a non-const array: reads as a view, assigns through set
+class BigIntegerArray::Element
+{
+public:
+	operator BigIntegerView() const { return static_cast<const BigIntegerArray&>(*array)[index]; }
+	explicit operator BigInteger() const { return BigInteger(BigIntegerView(*this)); }
+	Element& operator = (const BigIntegerView& n) { array->set(index, n); return (*this); }
+	Element& operator = (const Element& e) { array->set(index, e); return (*this); }
+private:
+	friend class BigIntegerArray;
+	Element(BigIntegerArray* a, size_t i) : array(a), index(i) {}
+	BigIntegerArray* array;
+	size_t index;
+};
+
+inline BigIntegerArray::Element BigIntegerArray::operator [] (size_t i)
+{
+	return Element(this, i);
+}
+
+inline void swap(BigInteger& a, BigInteger& b)
+{
+	a.swap(b);
+}
+
+BigInteger pow(const BigInteger& base, unsigned long long exponent); // pow(0, 0) is 1
+// base^exponent mod |modulus|, in [0, |modulus|); the exponent must not be -ve
+BigInteger powmod(const BigInteger& base, const BigInteger& exponent, const BigInteger& modulus);
+BigInteger isqrt(const BigInteger& n); // floor of the square root, n must not be -ve
+BigInteger iroot(const BigInteger& n, unsigned int k); // k-th root rounded toward zero
+BigInteger gcd(const BigInteger& a, const BigInteger& b); // never -ve, gcd(0, 0) is 0
+BigInteger lcm(const BigInteger& a, const BigInteger& b); // never -ve
+
+// exact factorials and binomials from their prime factorization: a
+// sieve lists the primes, Legendre's formula gives their exponents, and
+// the prime powers are multiplied through product trees
+BigInteger factorial(unsigned int n);
+BigInteger binomial(unsigned long long n, unsigned long long k); // 0 if k > n
+BigInteger multinomial(const vector<unsigned int>& k); // (k0 + k1 + ...)! / (k0! k1! ...)
+BigInteger primorial(unsigned int n); // product of the primes up to n
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef BIGINTEGEREXPR_H
+#define BIGINTEGEREXPR_H
+
+#include <algorithm>
+#include <utility>
+#include "BigInteger.h"
+
+using namespace std;
+//-------------------------------------------------------------
+// opt-in lazy evaluation. wrapping an operand in lazy() makes +, - and *
+// build an expression tree instead of a BigInteger; the tree is evaluated
+// when it is assigned or converted to a BigInteger:
+//
+//	r = lazy(a) * b + lazy(c) * d - e; // one result buffer, sized up front
+//
+// an operator with no lazy operand (c * d) is still evaluated on the
+// spot. sums are flattened and added in place, and every product that is
+// added or subtracted goes through addmul/submul, so no temporary is made
+// for it. the tree holds references to its operands, so evaluate it
+// within the same statement rather than keeping it in an auto variable
+template<class E>
+struct LazyExpr
+{
+	const E& self() const { return static_cast<const E&>(*this); }
+	operator BigInteger() const; // evaluates the tree
+};
+
+struct LazyRef : LazyExpr<LazyRef>
+{
+	const BigInteger& value;
+	explicit LazyRef(const BigInteger& v) : value(v) {}
+};
+
+template<class L, class R>
+struct LazyAdd : LazyExpr< LazyAdd<L, R> >
+{
+	L left;
+	R right;
+	LazyAdd(const L& l, const R& r) : left(l), right(r) {}
+};
+
+template<class L, class R>
+struct LazySub : LazyExpr< LazySub<L, R> >
+{
+	L left;
+	R right;
+	LazySub(const L& l, const R& r) : left(l), right(r) {}
+};
+
+template<class L, class R>
+struct LazyMul : LazyExpr< LazyMul<L, R> >
+{
+	L left;
+	R right;
+	LazyMul(const L& l, const R& r) : left(l), right(r) {}
+};
+
+template<class X>
+struct LazyNeg : LazyExpr< LazyNeg<X> >
+{
+	X operand;
+	explicit LazyNeg(const X& x) : operand(x) {}
+};
+
+inline LazyRef lazy(const BigInteger& n)
+{
+	return LazyRef(n);
+}
+
+//-------------------------------------------------------------
+// walks the trees; a friend of BigInteger so it can size and fill the
+// result's limbs directly
+struct LazyEvaluator
+{
+	// upper bound on the limbs of the result
+	static size_t bound(const LazyRef& e) { return e.value.number.size(); }
+	template<class L, class R> static size_t bound(const LazyAdd<L, R>& e) { return max(bound(e.left), bound(e.right)) + 1; }
+	template<class L, class R> static size_t bound(const LazySub<L, R>& e) { return max(bound(e.left), bound(e.right)) + 1; }
+	template<class L, class R> static size_t bound(const LazyMul<L, R>& e) { return bound(e.left) + bound(e.right); }
+	template<class X> static size_t bound(const LazyNeg<X>& e) { return bound(e.operand); }
+
+	// true if n is one of the operands
+	static bool refers(const LazyRef& e, const BigInteger* n) { return &e.value == n; }
+	template<class L, class R> static bool refers(const LazyAdd<L, R>& e, const BigInteger* n) { return refers(e.left, n) || refers(e.right, n); }
+	template<class L, class R> static bool refers(const LazySub<L, R>& e, const BigInteger* n) { return refers(e.left, n) || refers(e.right, n); }
+	template<class L, class R> static bool refers(const LazyMul<L, R>& e, const BigInteger* n) { return refers(e.left, n) || refers(e.right, n); }
+	template<class X> static bool refers(const LazyNeg<X>& e, const BigInteger* n) { return refers(e.operand, n); }
+
+	// operands of a product, materialized unless they are plain numbers
+	static const BigInteger& value(const LazyRef& e) { return e.value; }
+	template<class E> static BigInteger value(const LazyExpr<E>& e) { return e; }
+
+	// out = e, out does not alias any operand
+	static void eval(BigInteger& out, const LazyRef& e)
+	{
+		out = e.value; // copies into the reserved buffer
+	}
+	template<class L, class R> static void eval(BigInteger& out, const LazyAdd<L, R>& e)
+	{
+		eval(out, e.left);
+		accumulate(out, e.right, false);
+	}
+	template<class L, class R> static void eval(BigInteger& out, const LazySub<L, R>& e)
+	{
+		eval(out, e.left);
+		accumulate(out, e.right, true);
+	}
+	template<class L, class R> static void eval(BigInteger& out, const LazyMul<L, R>& e)
+	{
+		const BigInteger& a = value(e.left);
+		const BigInteger& b = value(e.right);
+		out.number.clear();
+		out.sign = false;
+		if(a.number.empty() || b.number.empty())
+			return;
+		out.number.resize(a.number.size() + b.number.size()); // fits in the reserved buffer
+		BigInteger::mul(a.number.data(), a.number.size(), b.number.data(), b.number.size(), out.number.data());
+		BigInteger::trim(out.number);
+		out.sign = (a.sign != b.sign);
+	}
+	template<class X> static void eval(BigInteger& out, const LazyNeg<X>& e)
+	{
+		eval(out, e.operand);
+		out.sign = ! out.sign && ! out.number.empty();
+	}
+
+	// out += (-1)^negative * e
+	static void accumulate(BigInteger& out, const LazyRef& e, bool negative)
+	{
+		out.accumulate(e.value.number, e.value.sign != negative);
+	}
+	template<class L, class R> static void accumulate(BigInteger& out, const LazyAdd<L, R>& e, bool negative)
+	{
+		accumulate(out, e.left, negative);
+		accumulate(out, e.right, negative);
+	}
+	template<class L, class R> static void accumulate(BigInteger& out, const LazySub<L, R>& e, bool negative)
+	{
+		accumulate(out, e.left, negative);
+		accumulate(out, e.right, ! negative);
+	}
+	template<class L, class R> static void accumulate(BigInteger& out, const LazyMul<L, R>& e, bool negative)
+	{
+		const BigInteger& a = value(e.left);
+		const BigInteger& b = value(e.right);
+		out.mulAccumulate(a.number, b.number, (a.sign != b.sign) != negative);
+	}
+	template<class X> static void accumulate(BigInteger& out, const LazyNeg<X>& e, bool negative)
+	{
+		accumulate(out, e.operand, ! negative);
+	}
+
+	template<class E> static BigInteger evaluate(const E& e)
+	{
+		BigInteger res;
+		res.number.reserve(bound(e) + 1);
+		eval(res, e);
+		return res;
+	}
+};
+
+template<class E>
+LazyExpr<E>::operator BigInteger() const
+{
+	return LazyEvaluator::evaluate(self());
+}
+
+// n += e and n -= e add the terms of e into n one by one
+template<class E>
+BigInteger& operator += (BigInteger& n, const LazyExpr<E>& e)
+{
+	if(LazyEvaluator::refers(e.self(), &n))
+		return n += BigInteger(e);
+	LazyEvaluator::accumulate(n, e.self(), false);
+	return n;
+}
+
+template<class E>
+BigInteger& operator -= (BigInteger& n, const LazyExpr<E>& e)
+{
+	if(LazyEvaluator::refers(e.self(), &n))
+		return n -= BigInteger(e);
+	LazyEvaluator::accumulate(n, e.self(), true);
+	return n;
+}
+
+//-------------------------------------------------------------
+// tree building, at least one side must already be lazy
+template<class L, class R> LazyAdd<L, R> operator + (const LazyExpr<L>& l, const LazyExpr<R>& r) { return LazyAdd<L, R>(l.self(), r.self()); }
+template<class L> LazyAdd<L, LazyRef> operator + (const LazyExpr<L>& l, const BigInteger& r) { return LazyAdd<L, LazyRef>(l.self(), LazyRef(r)); }
+template<class R> LazyAdd<LazyRef, R> operator + (const BigInteger& l, const LazyExpr<R>& r) { return LazyAdd<LazyRef, R>(LazyRef(l), r.self()); }
+
+template<class L, class R> LazySub<L, R> operator - (const LazyExpr<L>& l, const LazyExpr<R>& r) { return LazySub<L, R>(l.self(), r.self()); }
+template<class L> LazySub<L, LazyRef> operator - (const LazyExpr<L>& l, const BigInteger& r) { return LazySub<L, LazyRef>(l.self(), LazyRef(r)); }
+template<class R> LazySub<LazyRef, R> operator - (const BigInteger& l, const LazyExpr<R>& r) { return LazySub<LazyRef, R>(LazyRef(l), r.self()); }
+
+template<class L, class R> LazyMul<L, R> operator * (const LazyExpr<L>& l, const LazyExpr<R>& r) { return LazyMul<L, R>(l.self(), r.self()); }
+template<class L> LazyMul<L, LazyRef> operator * (const LazyExpr<L>& l, const BigInteger& r) { return LazyMul<L, LazyRef>(l.self(), LazyRef(r)); }
+template<class R> LazyMul<LazyRef, R> operator * (const BigInteger& l, const LazyExpr<R>& r) { return LazyMul<LazyRef, R>(LazyRef(l), r.self()); }
+
+template<class X> LazyNeg<X> operator - (const LazyExpr<X>& x) { return LazyNeg<X>(x.self()); }
+
+#endif
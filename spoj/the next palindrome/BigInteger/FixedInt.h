@@ -0,0 +1,315 @@
+#ifndef FIXEDINT_H
+#define FIXEDINT_H
+
+#include <string>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include "BigInteger.h"
+
+using namespace std;
+//-------------------------------------------------------------
+// signed integer of a fixed number of bits with its limbs stored inline,
+// for values whose bound is known up front. arithmetic wraps around
+// modulo 2^Bits like the built-in types; / and % round toward zero as in
+// BigInteger. everything but string output is constexpr, so constants
+// such as FixedInt<256>("123456789012345678901234567890") can be folded
+// at compile time
+template<unsigned Bits>
+class FixedInt
+{
+	static_assert(Bits % 32 == 0 && Bits >= 64, "FixedInt needs a multiple of 32 bits, at least 64");
+public:
+	typedef unsigned int limb;
+	typedef unsigned long long dlimb;
+	static const unsigned N = Bits / 32; // limbs, little endian two's complement
+private:
+	limb v[N];
+public:
+	constexpr FixedInt() : v{} {} // zero
+	template<class T, class = typename enable_if<is_integral<T>::value>::type>
+	constexpr FixedInt(T n) : v{} // any built-in integer
+	{
+		dlimb w = (dlimb) n;
+		v[0] = (limb) w;
+		v[1] = (limb) (w >> 32);
+		for(unsigned i=2; i<N; ++i)
+			v[i] = (n < 0) ? ~0U : 0; // sign extension
+	}
+	constexpr explicit FixedInt(const char* s) : v{} // optional sign then decimal digits
+	{
+		bool negative = (*s == '-');
+		if(*s == '-' || *s == '+')
+			++s;
+		for(; *s >= '0' && *s <= '9'; ++s)
+			mulAddWord(10, *s - '0');
+		if(negative)
+			negate();
+	}
+	explicit FixedInt(const string& s) : FixedInt(s.c_str()) {}
+	explicit FixedInt(const BigInteger& b) : v{} // keeps the low Bits bits of b
+	{
+		for(unsigned i=0; i<N && i<b.number.size(); ++i)
+			v[i] = b.number[i];
+		if(b.sign)
+			negate();
+	}
+	explicit operator BigInteger() const
+	{
+		FixedInt mag = absolute();
+		BigInteger b;
+		b.number.assign(mag.v, mag.v + N);
+		BigInteger::trim(b.number);
+		b.sign = getSign();
+		return b;
+	}
+	explicit operator string() const; // for conversion from FixedInt to string
+
+	constexpr bool getSign() const { return v[N - 1] >> 31; } // true if -ve
+	constexpr FixedInt absolute() const { return getSign() ? -(*this) : (*this); } // the minimum stays -ve
+	constexpr limb limbAt(unsigned i) const { return v[i]; }
+
+	constexpr bool operator == (const FixedInt& b) const
+	{
+		for(unsigned i=0; i<N; ++i)
+			if(v[i] != b.v[i])
+				return false;
+		return true;
+	}
+	constexpr bool operator != (const FixedInt& b) const { return ! (*this == b); }
+	constexpr bool operator < (const FixedInt& b) const
+	{
+		if(getSign() != b.getSign())
+			return getSign();
+		return compareMagnitude(v, b.v) < 0; // same sign, compare as unsigned
+	}
+	constexpr bool operator > (const FixedInt& b) const { return b < (*this); }
+	constexpr bool operator <= (const FixedInt& b) const { return ! (b < (*this)); }
+	constexpr bool operator >= (const FixedInt& b) const { return ! ((*this) < b); }
+
+	constexpr FixedInt& operator += (const FixedInt& b)
+	{
+		dlimb carry = 0;
+		for(unsigned i=0; i<N; ++i)
+		{
+			carry += (dlimb) v[i] + b.v[i];
+			v[i] = (limb) carry;
+			carry >>= 32;
+		}
+		return (*this);
+	}
+	constexpr FixedInt& operator -= (const FixedInt& b)
+	{
+		limb borrow = 0;
+		for(unsigned i=0; i<N; ++i)
+		{
+			dlimb d = (dlimb) v[i] - b.v[i] - borrow;
+			v[i] = (limb) d;
+			borrow = (limb) (d >> 63);
+		}
+		return (*this);
+	}
+	constexpr FixedInt& operator *= (const FixedInt& b)
+	{
+		// schoolbook, only the low N limbs of the product are kept
+		limb r[N] = {};
+		for(unsigned i=0; i<N; ++i)
+		{
+			dlimb carry = 0;
+			for(unsigned j=0; i+j<N; ++j)
+			{
+				carry += r[i + j] + (dlimb) v[i] * b.v[j];
+				r[i + j] = (limb) carry;
+				carry >>= 32;
+			}
+		}
+		for(unsigned i=0; i<N; ++i)
+			v[i] = r[i];
+		return (*this);
+	}
+	constexpr FixedInt& operator /= (const FixedInt& b) { FixedInt r; divide(*this, b, *this, r); return (*this); }
+	constexpr FixedInt& operator %= (const FixedInt& b) { FixedInt q; divide(*this, b, q, *this); return (*this); }
+
+	constexpr FixedInt operator + (const FixedInt& b) const { FixedInt r = (*this); return r += b; }
+	constexpr FixedInt operator - (const FixedInt& b) const { FixedInt r = (*this); return r -= b; }
+	constexpr FixedInt operator * (const FixedInt& b) const { FixedInt r = (*this); return r *= b; }
+	constexpr FixedInt operator / (const FixedInt& b) const { FixedInt r = (*this); return r /= b; }
+	constexpr FixedInt operator % (const FixedInt& b) const { FixedInt r = (*this); return r %= b; }
+	constexpr FixedInt operator -() const { FixedInt r = (*this); r.negate(); return r; } // unary minus sign
+
+	constexpr FixedInt& operator ++() { return (*this) += 1; } // prefix
+	constexpr FixedInt  operator ++(int) { FixedInt old = (*this); ++(*this); return old; } // postfix
+	constexpr FixedInt& operator --() { return (*this) -= 1; } // prefix
+	constexpr FixedInt  operator --(int) { FixedInt old = (*this); --(*this); return old; } // postfix
+
+	// quotient and remainder of one division, truncating toward zero
+	static constexpr void divide(const FixedInt& a, const FixedInt& b, FixedInt& q, FixedInt& r)
+	{
+		if(b == FixedInt())
+			throw domain_error("FixedInt: division by zero");
+		bool qNegative = a.getSign() != b.getSign(), rNegative = a.getSign();
+		FixedInt n = a.absolute(), d = b.absolute(); // as unsigned, so the minimum is fine
+		divideMagnitude(n.v, d.v, q.v, r.v);
+		if(qNegative)
+			q.negate();
+		if(rNegative)
+			r.negate();
+	}
+private:
+	constexpr void negate()
+	{
+		dlimb carry = 1;
+		for(unsigned i=0; i<N; ++i)
+		{
+			carry += (limb) ~v[i];
+			v[i] = (limb) carry;
+			carry >>= 32;
+		}
+	}
+	constexpr limb mulAddWord(limb m, limb a) // (*this) = (*this) * m + a, returns the overflow
+	{
+		dlimb carry = a;
+		for(unsigned i=0; i<N; ++i)
+		{
+			carry += (dlimb) v[i] * m;
+			v[i] = (limb) carry;
+			carry >>= 32;
+		}
+		return (limb) carry;
+	}
+	static constexpr int compareMagnitude(const limb* a, const limb* b)
+	{
+		for(unsigned i=N; i-->0; )
+			if(a[i] != b[i])
+				return a[i] < b[i] ? -1 : 1;
+		return 0;
+	}
+	static constexpr unsigned significant(const limb* a)
+	{
+		unsigned n = N;
+		while(n > 0 && a[n - 1] == 0)
+			--n;
+		return n;
+	}
+	// unsigned n / d, d != 0; Knuth's algorithm D on inline arrays
+	static constexpr void divideMagnitude(const limb* n, const limb* d, limb* q, limb* r)
+	{
+		unsigned m = significant(n), len = significant(d);
+		for(unsigned i=0; i<N; ++i)
+			q[i] = r[i] = 0;
+		if(compareMagnitude(n, d) < 0)
+		{
+			for(unsigned i=0; i<N; ++i)
+				r[i] = n[i];
+			return;
+		}
+		if(len == 1)
+		{
+			dlimb rem = 0;
+			for(unsigned i=m; i-->0; )
+			{
+				dlimb cur = (rem << 32) | n[i];
+				q[i] = (limb) (cur / d[0]);
+				rem = cur % d[0];
+			}
+			r[0] = (limb) rem;
+			return;
+		}
+
+		// normalize so the top bit of the divisor is set
+		int s = __builtin_clz(d[len - 1]);
+		limb un[N + 1] = {}, vn[N] = {};
+		for(unsigned i=len; i-->0; )
+			vn[i] = (d[i] << s) | (s && i ? d[i - 1] >> (32 - s) : 0);
+		un[m] = s ? n[m - 1] >> (32 - s) : 0;
+		for(unsigned i=m; i-->0; )
+			un[i] = (n[i] << s) | (s && i ? n[i - 1] >> (32 - s) : 0);
+
+		for(unsigned j=m-len+1; j-->0; )
+		{
+			// estimate the quotient limb from the top two limbs, then fix it
+			dlimb top = ((dlimb) un[j + len] << 32) | un[j + len - 1];
+			dlimb qhat = top / vn[len - 1], rhat = top % vn[len - 1];
+			while(qhat >> 32 || qhat * vn[len - 2] > ((rhat << 32) | un[j + len - 2]))
+			{
+				--qhat;
+				rhat += vn[len - 1];
+				if(rhat >> 32)
+					break;
+			}
+
+			// un[j..j+len] -= qhat * vn
+			long long borrow = 0;
+			dlimb carry = 0;
+			for(unsigned i=0; i<len; ++i)
+			{
+				carry += qhat * vn[i];
+				long long t = (long long) un[i + j] - borrow - (long long) (limb) carry;
+				un[i + j] = (limb) t;
+				carry >>= 32;
+				borrow = (t < 0) ? 1 : 0;
+			}
+			long long t = (long long) un[j + len] - borrow - (long long) carry;
+			un[j + len] = (limb) t;
+
+			if(t < 0) // qhat was one too big, add vn back
+			{
+				--qhat;
+				dlimb c = 0;
+				for(unsigned i=0; i<len; ++i)
+				{
+					c += (dlimb) un[i + j] + vn[i];
+					un[i + j] = (limb) c;
+					c >>= 32;
+				}
+				un[j + len] += (limb) c;
+			}
+			q[j] = (limb) qhat;
+		}
+
+		for(unsigned i=0; i<len; ++i)
+			r[i] = (un[i] >> s) | (s ? (dlimb) un[i + 1] << (32 - s) : 0);
+	}
+};
+
+//-------------------------------------------------------------
+template<unsigned Bits>
+FixedInt<Bits>::operator string() const
+{
+	// peel off 9 decimal digits at a time, least significant first
+	FixedInt mag = absolute();
+	string digits;
+	do
+	{
+		dlimb rem = 0;
+		for(unsigned i=N; i-->0; )
+		{
+			dlimb cur = (rem << 32) | mag.v[i];
+			mag.v[i] = (limb) (cur / 1000000000);
+			rem = cur % 1000000000;
+		}
+		bool last = (significant(mag.v) == 0);
+		for(int k=0; k<9 && (! last || rem != 0); ++k, rem /= 10)
+			digits += (char) ('0' + rem % 10);
+		if(last)
+			break;
+	} while(true);
+
+	if(digits.empty())
+		digits = "0";
+	if(getSign())
+		digits += '-';
+	return string(digits.rbegin(), digits.rend());
+}
+
+template<unsigned Bits>
+ostream& operator << (ostream& os, const FixedInt<Bits>& n)
+{
+	return os << (string) n;
+}
+
+typedef FixedInt<128> Int128;
+typedef FixedInt<256> Int256;
+typedef FixedInt<512> Int512;
+
+#endif
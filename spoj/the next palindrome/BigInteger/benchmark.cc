@@ -0,0 +1,327 @@
+// Microbenchmarks for BigInteger, one row per operation and operand size:
+//
+//	g++ -O2 -std=c++14 -pthread benchmark.cc BigInteger.cpp -o benchmark
+//	./benchmark --json new.json --baseline old.json
+//
+// options:
+//	--ops +,-,*,/,%,cmp,inc,parse,print   operations to run (default all)
+//	--max-digits N    largest operand, sizes go 1, 10, 100, ... up to N (default 1000000)
+//	--min-time MS     time each case for at least MS milliseconds (default 200)
+//	--json FILE       also write the results as JSON, one case per line
+//	--baseline FILE   compare against a JSON file written earlier
+//	--tolerance PCT   slowdown over the baseline reported as a regression (default 10)
+//	--threads N       BigInteger::setThreads(N)
+//	--simd LEVEL      BigInteger::setSimdLevel(LEVEL)
+//
+// the exit status is 1 if a case regressed against the baseline
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include "BigInteger.h"
+
+using namespace std;
+//-------------------------------------------------------------
+// allocation counting: limbs come from malloc and realloc, everything
+// else through operator new, which ends in malloc too. with glibc the
+// program's own malloc takes precedence over the library's
+static atomic<unsigned long long> allocations(0);
+
+#ifdef __GLIBC__
+extern "C"
+{
+	void* __libc_malloc(size_t n);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* p, size_t n);
+
+	void* malloc(size_t n)
+	{
+		allocations.fetch_add(1, memory_order_relaxed);
+		return __libc_malloc(n);
+	}
+	void* calloc(size_t n, size_t size)
+	{
+		allocations.fetch_add(1, memory_order_relaxed);
+		return __libc_calloc(n, size);
+	}
+	void* realloc(void* p, size_t n)
+	{
+		allocations.fetch_add(1, memory_order_relaxed);
+		return __libc_realloc(p, n);
+	}
+}
+static const bool countingAllocations = true;
+#else
+static const bool countingAllocations = false; // allocs/op is reported as -1
+#endif
+
+//-------------------------------------------------------------
+struct Result
+{
+	string op;
+	size_t digits;
+	unsigned long long iterations;
+	double nsPerOp;
+	double digitsPerSecond; // operand digits processed per second
+	double allocsPerOp;
+};
+
+// digits random decimal digits without a leading zero
+static string randomDigits(size_t digits, unsigned int& seed)
+{
+	string s(digits, '0');
+	for(size_t i=0; i<digits; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		s[i] = (char) ('0' + (seed >> 16) % 10);
+	}
+	if(s[0] == '0')
+		s[0] = '1';
+	return s;
+}
+
+// keeps the optimizer from dropping a result
+static volatile size_t sink;
+
+static void consume(const BigInteger& n)
+{
+	sink = sink + n.getSign();
+}
+
+// the operands of one case; divisions take a divisor of half the digits
+struct Operands
+{
+	string text;
+	BigInteger a, b, half, near; // near differs from a in its last digit only
+	Operands(size_t digits, unsigned int seed)
+	{
+		text = randomDigits(digits, seed);
+		a = BigInteger(text);
+		b = BigInteger(randomDigits(digits, seed));
+		half = BigInteger(randomDigits(max<size_t>(digits / 2, 1), seed));
+		string t = text;
+		t[t.size() - 1] = (t[t.size() - 1] == '9') ? '8' : t[t.size() - 1] + 1;
+		near = BigInteger(t);
+	}
+};
+
+// runs op once; false if the name is unknown
+static bool runOnce(const string& op, Operands& x)
+{
+	if(op == "+")
+		consume(x.a + x.b);
+	else if(op == "-")
+		consume(x.a - x.b);
+	else if(op == "*")
+		consume(x.a * x.b);
+	else if(op == "/")
+		consume(x.a / x.half);
+	else if(op == "%")
+		consume(x.a % x.half);
+	else if(op == "cmp")
+		sink = sink + (x.a < x.near);
+	else if(op == "inc")
+		consume(++x.a);
+	else if(op == "parse")
+		consume(BigInteger(x.text));
+	else if(op == "print")
+		sink = sink + ((string) x.a).size();
+	else
+		return false;
+	return true;
+}
+
+// times op in batches that double until minTime has passed
+static Result measure(const string& op, size_t digits, double minTime)
+{
+	Operands x(digits, 12345 + (unsigned int) digits);
+	runOnce(op, x); // warm up caches and tables
+
+	typedef chrono::steady_clock clock;
+	unsigned long long iterations = 0, batch = 1, allocated = 0;
+	double elapsed = 0;
+	while(elapsed < minTime)
+	{
+		unsigned long long before = allocations.load(memory_order_relaxed);
+		clock::time_point start = clock::now();
+		for(unsigned long long i=0; i<batch; ++i)
+			runOnce(op, x);
+		elapsed += chrono::duration<double, nano>(clock::now() - start).count();
+		allocated += allocations.load(memory_order_relaxed) - before;
+		iterations += batch;
+		batch *= 2;
+	}
+
+	Result r;
+	r.op = op;
+	r.digits = digits;
+	r.iterations = iterations;
+	r.nsPerOp = elapsed / iterations;
+	r.digitsPerSecond = digits * 1e9 / r.nsPerOp;
+	r.allocsPerOp = countingAllocations ? (double) allocated / iterations : -1;
+	return r;
+}
+
+//-------------------------------------------------------------
+static string toJson(const Result& r)
+{
+	ostringstream os;
+	os << "{\"op\": \"" << r.op << "\", \"digits\": " << r.digits << ", \"iterations\": " << r.iterations
+		<< setprecision(10) << ", \"ns_per_op\": " << r.nsPerOp << ", \"digits_per_s\": " << r.digitsPerSecond
+		<< ", \"allocs_per_op\": " << r.allocsPerOp << "}";
+	return os.str();
+}
+
+// value of "key": in a line written by toJson, empty if absent
+static string jsonField(const string& line, const string& key)
+{
+	size_t at = line.find("\"" + key + "\":");
+	if(at == string::npos)
+		return string();
+	at = line.find_first_not_of(" \"", at + key.size() + 3);
+	size_t end = line.find_first_of(",\"}", at);
+	return line.substr(at, end - at);
+}
+
+// ns/op of every case in a baseline file, keyed by op and digits
+static map<pair<string, size_t>, double> readBaseline(const string& path)
+{
+	map<pair<string, size_t>, double> cases;
+	ifstream in(path.c_str());
+	if(! in)
+	{
+		cerr << "cannot read baseline " << path << endl;
+		exit(2);
+	}
+	string line;
+	while(getline(in, line))
+	{
+		string op = jsonField(line, "op"), digits = jsonField(line, "digits"), ns = jsonField(line, "ns_per_op");
+		if(! op.empty() && ! digits.empty() && ! ns.empty())
+			cases[make_pair(op, (size_t) strtoull(digits.c_str(), nullptr, 10))] = strtod(ns.c_str(), nullptr);
+	}
+	return cases;
+}
+
+static vector<string> split(const string& s, char separator)
+{
+	vector<string> parts;
+	stringstream ss(s);
+	string part;
+	while(getline(ss, part, separator))
+		if(! part.empty())
+			parts.push_back(part);
+	return parts;
+}
+
+//-------------------------------------------------------------
+int main(int argc, char** argv)
+{
+	vector<string> ops = split("+,-,*,/,%,cmp,inc,parse,print", ',');
+	size_t maxDigits = 1000000;
+	double minTime = 200e6; // ns
+	double tolerance = 10;
+	string jsonPath, baselinePath;
+
+	for(int i=1; i<argc; ++i)
+	{
+		string arg = argv[i];
+		if(i + 1 == argc)
+		{
+			cerr << "missing value for " << arg << endl;
+			return 2;
+		}
+		string value = argv[++i];
+		if(arg == "--ops")
+			ops = split(value, ',');
+		else if(arg == "--max-digits")
+			maxDigits = strtoull(value.c_str(), nullptr, 10);
+		else if(arg == "--min-time")
+			minTime = strtod(value.c_str(), nullptr) * 1e6;
+		else if(arg == "--json")
+			jsonPath = value;
+		else if(arg == "--baseline")
+			baselinePath = value;
+		else if(arg == "--tolerance")
+			tolerance = strtod(value.c_str(), nullptr);
+		else if(arg == "--threads")
+			BigInteger::setThreads((unsigned) strtoul(value.c_str(), nullptr, 10));
+		else if(arg == "--simd")
+		{
+			if(! BigInteger::setSimdLevel(value))
+			{
+				cerr << "unsupported simd level " << value << endl;
+				return 2;
+			}
+		}
+		else
+		{
+			cerr << "unknown option " << arg << endl;
+			return 2;
+		}
+	}
+
+	Operands probe(1, 1);
+	for(size_t i=0; i<ops.size(); ++i)
+		if(! runOnce(ops[i], probe))
+		{
+			cerr << "unknown operation " << ops[i] << endl;
+			return 2;
+		}
+
+	map<pair<string, size_t>, double> baseline;
+	if(! baselinePath.empty())
+		baseline = readBaseline(baselinePath);
+
+	cout << "simd " << BigInteger::simdLevel() << ", " << BigInteger::threads() << " thread(s)" << endl;
+	cout << left << setw(7) << "op" << right << setw(9) << "digits" << setw(12) << "iterations" << setw(16) << "ns/op"
+		<< setw(14) << "Mdigits/s" << setw(12) << "allocs/op";
+	if(! baseline.empty())
+		cout << setw(16) << "baseline ns/op" << setw(9) << "change";
+	cout << endl;
+
+	vector<Result> results;
+	int regressions = 0;
+	for(size_t i=0; i<ops.size(); ++i)
+		for(size_t digits=1; digits<=maxDigits; digits*=10)
+		{
+			Result r = measure(ops[i], digits, minTime);
+			results.push_back(r);
+
+			cout << left << setw(7) << r.op << right << setw(9) << r.digits << setw(12) << r.iterations
+				<< fixed << setprecision(1) << setw(16) << r.nsPerOp << setprecision(2) << setw(14) << r.digitsPerSecond / 1e6
+				<< setw(12) << r.allocsPerOp;
+			map<pair<string, size_t>, double>::const_iterator old = baseline.find(make_pair(r.op, r.digits));
+			if(old != baseline.end())
+			{
+				double change = (r.nsPerOp / old->second - 1) * 100; // +ve is slower
+				cout << setprecision(1) << setw(16) << old->second << setw(8) << showpos << change << noshowpos << "%";
+				if(change > tolerance)
+				{
+					cout << "  REGRESSION";
+					++regressions;
+				}
+			}
+			cout << endl;
+		}
+
+	if(! jsonPath.empty())
+	{
+		ofstream out(jsonPath.c_str());
+		out << "[" << endl;
+		for(size_t i=0; i<results.size(); ++i)
+			out << "  " << toJson(results[i]) << (i + 1 < results.size() ? "," : "") << endl;
+		out << "]" << endl;
+	}
+
+	if(regressions != 0)
+		cout << regressions << " case(s) slower than the baseline by more than " << tolerance << "%" << endl;
+	return regressions != 0 ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+// Regression checks for BigInteger: one function per bug fixed, and checks
+// of the algorithms against identities or each other across their tiers:
+//
+//	g++ -O2 -std=c++14 -pthread regression.cc BigInteger.cpp -o regression
+//	./regression
+//
+// prints each failed check and exits with 1 if there was one. races
+// only show reliably when built with -fsanitize=thread
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <random>
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include "BigInteger.h"
+
+using namespace std;
+//-------------------------------------------------------------
+static int failures = 0;
+
+static void expect(const string& what, const BigInteger& got, const string& expected)
+{
+	if((string) got == expected)
+		return;
+	cout << "FAILED " << what << ": got " << got << ", expected " << expected << endl;
+	++failures;
+}
+
+static void check(const string& what, bool ok)
+{
+	if(ok)
+		return;
+	cout << "FAILED " << what << endl;
+	++failures;
+}
+
+// limbs random 32 bit limbs, or runs of all ones and zeros, which are
+// where quotient estimates and carries go wrong
+static BigInteger randomNumber(mt19937& gen, size_t limbs)
+{
+	BigInteger x;
+	bool runs = gen() % 4 == 0;
+	for(size_t i=0; i<limbs; ++i)
+	{
+		unsigned int w = gen();
+		if(runs)
+			w = (w & 1) ? 0xFFFFFFFF : (w & 2) ? 0 : w;
+		x <<= 32;
+		x = x + BigInteger((int) (w >> 16)) * BigInteger(65536) + BigInteger((int) (w & 0xFFFF));
+	}
+	return x;
+}
+
+//-------------------------------------------------------------
+// sum() adds in place into the accumulator; a borrow that ran through a
+// zero limb of a -ve accumulator used to stop one limb early
+static void borrowThroughZeroLimb()
+{
+	vector<BigInteger> terms;
+	terms.push_back(BigInteger("-36893488147419103233")); // -(2^65 + 1), middle limb 0
+	terms.push_back(BigInteger(6582));
+	expect("sum across a zero limb", sum(terms), "-36893488147419096651");
+
+	terms.assign(1, BigInteger("-340282366920938463463374607431768211457")); // -(2^128 + 1)
+	terms.push_back(BigInteger(2));
+	expect("sum across zero limbs", sum(terms), "-340282366920938463463374607431768211455");
+}
+
+//-------------------------------------------------------------
+// the subtrees of product() and sum() that ran on pool threads used to
+// fill a number bound to the caller's arena, allocating from it on two
+// threads at once
+static void parallelReductionUnderArena()
+{
+	size_t threshold = BigInteger::parallelThreshold;
+	BigInteger::setThreads(4);
+	BigInteger::parallelThreshold = 8;
+
+	vector<BigInteger> terms;
+	for(int i=0; i<200; ++i)
+		terms.push_back(pow(BigInteger(3 + i), 300 + i));
+	string p = product(terms), s = sum(terms);
+	for(int k=0; k<3; ++k)
+	{
+		BigIntegerArena arena;
+		expect("product under an arena", product(terms), p);
+		expect("sum under an arena", sum(terms), s);
+	}
+
+	BigInteger::parallelThreshold = threshold;
+	BigInteger::setThreads(1);
+}
+
+//-------------------------------------------------------------
+// a default view has no digits at all; copying it used to hand a null
+// pointer to memmove
+static void emptyViewToNumber()
+{
+	BigIntegerView zero;
+	expect("number from an empty view", BigInteger(zero), "0");
+}
+
+//-------------------------------------------------------------
+// swap and move assignment hand buffers over only inside one arena, and
+// so are not noexcept; across arenas they copy, and a number made
+// outside must still hold its value once the arena is gone
+static void swapAcrossArenas()
+{
+	string big = "123456789012345678901234567890123456789", small = "-42";
+	BigInteger outside(big), moved, inline_(small);
+	{
+		BigIntegerArena arena;
+		BigInteger inside = BigInteger(small) * BigInteger(1), longer(big + big);
+		outside.swap(inside);
+		expect("swap into an arena", inside, big);
+		outside.swap(longer);
+		expect("longer swap into an arena", longer, small);
+		moved = std::move(inside);
+		inline_.swap(longer);
+	}
+	expect("swap out of an arena", outside, big + big);
+	expect("move out of an arena", moved, big);
+	expect("inline swap out of an arena", inline_, small);
+
+	BigInteger a(big), b(small); // same arena, the buffers trade places
+	a.swap(b);
+	b.swap(b);
+	expect("swap on the heap", a, small);
+	expect("swap with itself", b, big);
+}
+
+//-------------------------------------------------------------
+// printing splits at powers of ten by Barrett reduction and streams the
+// digits in blocks; runs of zero digits and numbers next to a power of
+// ten are where an estimate off by one shows
+static void printNearPowersOfTen()
+{
+	size_t threshold = BigInteger::radixThreshold;
+	BigInteger::radixThreshold = 2;
+	for(size_t digits : { 10, 19, 20, 100, 1000, 5000, 70000 })
+	{
+		string nines(digits, '9'), power = "1" + string(digits, '0');
+		string sparse = "7" + string(digits / 2, '0') + "3" + string(digits / 2, '0');
+		for(const string& s : { nines, power, sparse, "-" + sparse })
+		{
+			ostringstream os;
+			os << BigInteger(s);
+			expect("printed " + s.substr(0, 20) + "...", BigInteger(s), s);
+			if(os.str() != s)
+			{
+				cout << "FAILED streamed " << s.substr(0, 20) << "..." << endl;
+				++failures;
+			}
+		}
+	}
+	BigInteger::radixThreshold = threshold;
+}
+
+//-------------------------------------------------------------
+// a == q * b + r with |r| < |b| and r taking the sign of a, for
+// divisors on both sides of burnikelZieglerThreshold, and with the
+// threshold lowered so Burnikel-Ziegler recurses several levels
+static void divisionIdentity()
+{
+	size_t threshold = BigInteger::burnikelZieglerThreshold;
+	mt19937 gen(4);
+	for(size_t bz : { threshold, (size_t) 4 })
+	{
+		BigInteger::burnikelZieglerThreshold = bz;
+		for(size_t nb : { 2, 3, 17, 79, 80, 81, 160, 333 })
+			for(size_t extra : { 0, 1, 50, 81, 400 })
+			{
+				BigInteger a = randomNumber(gen, nb + extra), b = randomNumber(gen, nb);
+				if(b == 0)
+					b = 7;
+				if(gen() % 2)
+					a = -a;
+				if(gen() % 2)
+					b = -b;
+				pair<BigInteger, BigInteger> qr = a.divmod(b);
+				const BigInteger& q = qr.first;
+				const BigInteger& r = qr.second;
+				check("division identity, " + to_string(nb + extra) + " by " + to_string(nb) + " limbs, threshold " + to_string(bz),
+					q * b + r == a && r.absolute() < b.absolute() && (r == 0 || r.getSign() == a.getSign())
+					&& q == a / b && r == a % b);
+			}
+	}
+	BigInteger::burnikelZieglerThreshold = threshold;
+}
+
+// the quotient limb estimate in divKnuth is one too big here and the
+// divisor has to be added back (Hacker's Delight, divmnu's test cases)
+static void knuthAddBack()
+{
+	BigInteger n("170141183420855150474555134919112130560"); // limbs 0, 0, 2^31, 2^31 - 1
+	BigInteger d("39614081257132168796771975169"); // limbs 1, 0, 2^31
+	expect("quotient after add back", n / d, "4294967294");
+	expect("remainder after add back", n % d, "39614081257132168792477007874");
+}
+
+//-------------------------------------------------------------
+// the number theoretic transform must give the limbs Toom-3 gives, for
+// balanced and lopsided operands and for squares, which transform once.
+// all ones limbs make the largest convolution sums
+static void nttAgainstToom3()
+{
+	size_t toom3 = BigInteger::toom3Threshold, ntt = BigInteger::nttThreshold;
+	mt19937 gen(3);
+	size_t sizes[][2] = { { 16, 16 }, { 17, 40 }, { 100, 100 }, { 700, 650 }, { 3000, 1500 }, { 2048, 2048 } };
+	for(auto& size : sizes)
+	{
+		BigInteger a = randomNumber(gen, size[0]), b = randomNumber(gen, size[1]);
+		BigInteger ones = (BigInteger(1) << (32 * size[0])) - 1;
+		BigInteger::toom3Threshold = 16;
+		BigInteger::nttThreshold = (size_t) -1;
+		string product = a * b, square = a * a, onesSquare = ones * ones;
+		BigInteger::nttThreshold = 16;
+		string what = " of " + to_string(size[0]) + " by " + to_string(size[1]) + " limbs";
+		expect("ntt product" + what, a * b, product);
+		expect("ntt square" + what, a * a, square);
+		expect("ntt square of all ones" + what, ones * ones, onesSquare);
+	}
+	BigInteger::toom3Threshold = toom3;
+	BigInteger::nttThreshold = ntt;
+}
+
+//-------------------------------------------------------------
+// powmod reduces odd moduli below montgomeryThreshold limbs by
+// Montgomery and the rest by Barrett; both must agree with the plain
+// power reduced afterwards, for -ve bases too. everything is 0 mod 1
+static void powmodReducers()
+{
+	size_t threshold = BigInteger::montgomeryThreshold;
+	mt19937 gen(10);
+	for(size_t limbs : { 1, 2, 5, 40 })
+		for(int k=0; k<6; ++k)
+		{
+			BigInteger m = randomNumber(gen, limbs) + 2, base = randomNumber(gen, limbs + k % 3);
+			if(k % 2)
+				m = m * 2 + 1; // odd, so Montgomery below the threshold
+			if(k >= 4)
+				base = -base;
+			unsigned long long e = gen() % 60;
+			BigInteger expected = pow(base, e) % m;
+			if(expected < 0)
+				expected = expected + m;
+			string what = "powmod mod " + to_string(limbs) + " limbs, exponent " + to_string(e);
+
+			BigInteger::montgomeryThreshold = threshold;
+			expect(what, powmod(base, e, m), expected);
+			BigInteger::montgomeryThreshold = 0; // Barrett for every modulus
+			expect(what + ", Barrett", powmod(base, e, m), expected);
+		}
+	BigInteger::montgomeryThreshold = threshold;
+
+	expect("powmod mod 1", powmod(BigInteger(-12345), 67, 1), "0");
+	expect("powmod mod -1", powmod(BigInteger(12345), 0, -1), "0");
+	expect("powmod, exponent 0", powmod(BigInteger(-5), 0, 7), "1");
+	expect("powmod, -ve base", powmod(BigInteger(-2), 3, 5), "2");
+}
+
+// gcd divides both arguments and leaves coprime cofactors; a divisor
+// much shorter than the dividend leaves Lehmer's step without a certain
+// quotient (B == 0) and takes a full division instead
+static void gcdAndRoots()
+{
+	mt19937 gen(11);
+	size_t sizes[][2] = { { 3, 3 }, { 10, 9 }, { 40, 40 }, { 40, 3 }, { 200, 150 }, { 100, 4 } };
+	for(auto& size : sizes)
+	{
+		BigInteger c = randomNumber(gen, 2) + 1;
+		BigInteger a = randomNumber(gen, size[0]) * c, b = -(randomNumber(gen, size[1]) * c);
+		BigInteger g = gcd(a, b);
+		string what = "gcd of " + to_string(size[0]) + " and " + to_string(size[1]) + " limbs";
+		check(what, g > 0 && a % g == 0 && b % g == 0 && g % c == 0 && gcd(a / g, b / g) == 1);
+	}
+	expect("gcd(0, -x)", gcd(0, BigInteger("-123456789012345678901")), "123456789012345678901");
+	expect("gcd(0, 0)", gcd(0, 0), "0");
+
+	// r^k <= n < (r + 1)^k, and -ve n with odd k rounds toward zero
+	for(size_t limbs : { 1, 2, 3, 10, 60 })
+		for(unsigned int k : { 2, 3, 5, 17 })
+		{
+			BigInteger x = randomNumber(gen, limbs) + 1;
+			for(const BigInteger& n : { x, pow(x, k), pow(x, k) - 1 })
+			{
+				BigInteger r = iroot(n, k);
+				check("iroot " + to_string(k) + " of " + to_string(limbs) + " limbs", pow(r, k) <= n && n < pow(r + 1, k));
+			}
+			expect("iroot of -ve", iroot(-pow(x, 3) + 1, 3), (string) -(x - 1));
+		}
+	expect("isqrt", isqrt(BigInteger("99999999999999999999")), "9999999999");
+}
+
+//-------------------------------------------------------------
+// records read back through all three readers, two of them back to back
+// in one aligned buffer so the view has to find the second by *used
+static void serializeRoundTrip()
+{
+	mt19937 gen(15);
+	BigInteger values[] = { 0, -1, BigInteger(1) << 32, -((BigInteger(1) << 64) + 5), randomNumber(gen, 50) };
+	for(const BigInteger& x : values)
+	{
+		string record = x.serialize() + BigInteger(-7).serialize();
+		vector<unsigned int> aligned(record.size() / 4);
+		memcpy(aligned.data(), record.data(), record.size());
+
+		size_t used = 0;
+		string what = "round trip of " + (string) x;
+		check(what, BigInteger::deserialize(record.data(), record.size(), &used) == x && used == x.serializedSize());
+		istringstream is(record);
+		check(what + " through a stream", BigInteger::deserialize(is) == x && BigInteger::deserialize(is) == -7);
+		BigIntegerView view((const void*) aligned.data(), record.size(), &used), next((const char*) aligned.data() + used, record.size() - used);
+		check(what + " through a view", view == x && BigInteger(view) == x && next == BigInteger(-7));
+	}
+}
+
+// every reader must refuse the record with the given message
+static void rejects(const string& what, const string& record, const string& message)
+{
+	vector<unsigned int> aligned(record.size() / 4 + 1);
+	memcpy(aligned.data(), record.data(), record.size());
+	for(int reader=0; reader<3; ++reader)
+	{
+		try
+		{
+			istringstream is(record);
+			if(reader == 0)
+				BigInteger::deserialize(record.data(), record.size());
+			else if(reader == 1)
+				BigInteger::deserialize(is);
+			else
+				BigIntegerView(aligned.data(), record.size());
+			check(what + " accepted by reader " + to_string(reader), false);
+		}
+		catch(const invalid_argument& e)
+		{
+			check(what + " rejected by reader " + to_string(reader) + " with " + e.what(), e.what() == message);
+		}
+	}
+}
+
+static void serializeCorruptInput()
+{
+	const string record = (-((BigInteger(1) << 64) + 5)).serialize(); // limbs 5, 0, 1
+	string bad = record;
+	bad[0] = 'X';
+	rejects("wrong magic", bad, "BigInteger: not a serialized number");
+	bad = record;
+	bad[4] = 2;
+	rejects("wrong version", bad, "BigInteger: unsupported format version");
+	bad = record;
+	bad[5] = 2;
+	rejects("unknown flag", bad, "BigInteger: corrupt header");
+	rejects("truncated limbs", record.substr(0, record.size() - 1), "BigInteger: truncated number");
+	rejects("truncated header", record.substr(0, 10), "BigInteger: truncated number");
+	bad = record;
+	bad[record.size() - 4] = 0; // top limb 0
+	rejects("leading zero limb", bad, "BigInteger: number is not normalized");
+	bad = BigInteger(0).serialize();
+	bad[5] = 1;
+	rejects("-ve zero", bad, "BigInteger: number is not normalized");
+
+	vector<unsigned int> aligned(record.size() / 4 + 1);
+	memcpy((char*) aligned.data() + 1, record.data(), record.size());
+	try
+	{
+		BigIntegerView((const char*) aligned.data() + 1, record.size());
+		check("misaligned record accepted by a view", false);
+	}
+	catch(const invalid_argument&)
+	{
+	}
+}
+
+//-------------------------------------------------------------
+int main()
+{
+	borrowThroughZeroLimb();
+	parallelReductionUnderArena();
+	emptyViewToNumber();
+	swapAcrossArenas();
+	printNearPowersOfTen();
+	divisionIdentity();
+	knuthAddBack();
+	nttAgainstToom3();
+	powmodReducers();
+	gcdAndRoots();
+	serializeRoundTrip();
+	serializeCorruptInput();
+
+	if(failures != 0)
+		cout << failures << " check(s) failed" << endl;
+	return failures != 0 ? 1 : 0;
+}
@@ -1,20 +1,39 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 constexpr size_t kMaxDigits = 1000000;
 constexpr size_t kDefaultMaxLength = 500;
 constexpr size_t kDefaultN = 1000;
+constexpr size_t kIoBlockSize = 1 << 20; // Bytes per read() and write() in the batch drivers
+constexpr size_t kMapWindow = 64 << 20; // Bytes of a mapped input solved between writes
+constexpr int kMaxSlices = 1024; // iovecs per writev(), Linux's limit
 
+void NextBiggestPalindrome(char* K, size_t n, bool& all_nines);
 void NextBiggestPalindrome(std::vector<char>& K);
 void NextBiggestPalindrome(std::string& K);
 void NextBiggestPalindromeIterative(std::string& K);
@@ -28,13 +47,21 @@ inline bool IsPalindrome(const std::string& number) {
     return std::equal(number.begin(), number.begin() + number.size() / 2, number.rbegin());
 }
 
+// BigInteger drops leading zeros, but the palindrome kernels treat their input as a fixed-width
+// digit string (e.g. "0868" -> "0880"), so pad the digits back out to `width`.
+inline std::string PaddedDigits(const BigInteger& big_num, const size_t width) {
+    std::string digits = big_num.getNumber();
+    if (digits.size() < width) digits.insert(0, width - digits.size(), '0');
+    return digits;
+}
+
 std::string BruteForceNextPalindrome(const std::string& number) {
     BigInteger big_num{number};
     ++big_num; // Next palindrome must be bigger
 
-    while (!IsPalindrome(big_num.getNumber())) ++big_num;
+    while (!IsPalindrome(PaddedDigits(big_num, number.size()))) ++big_num;
 
-    return big_num.getNumber();
+    return PaddedDigits(big_num, number.size());
 }
 
 // Randomized testing.
@@ -179,87 +206,65 @@ inline int CharToDigit(const char& c) {
 }
 
 
-// DP solution
+// In-place solution for raw digit buffers: O(n) time, O(1) extra space and no recursion, so it
+// is safe on kMaxDigits-long inputs.
 
-void NextBiggestPalindrome(std::vector<char>& K, bool& all_nines) {
-    if (K.size() == 1) { // Base case: single-digit
-        int digit = CharToDigit(K.front());
-        if (digit == 9) {
-            all_nines = true;
-        } else {
-            ++K.front();
-            all_nines = false;
-        }
+// Sets the n digits at K to the smallest palindrome of the same width that is bigger. If there is
+// none (K is all 9's), sets `all_nines` and leaves K unchanged.
+void NextBiggestPalindrome(char* K, const size_t n, bool& all_nines) {
+    assert(n > 0);
 
-        return;
-    } else if (K.size() == 2) { // Base case: double-digit
-        int left = CharToDigit(K.front()), right = CharToDigit(K[1]);
-        if (left == 9 && right == 9) {
-            all_nines = true;
-        } else if (right < left) {
-            K.back() = K.front();
-            all_nines = false;
-        } else {
-            assert(left != 9);
-            ++K.front();
-            K.back() = K.front();
-            all_nines = false;
-        }
- 
-        return;
-    } else if (K.size() == 3) { // Base case: For odd number of digits (3 digits)
-        int left = CharToDigit(K.front()), middle = CharToDigit(K[1]),
-            right = CharToDigit(K.back());
+    // Walk outward from the center to the first pair of digits that differ from their mirror.
+    size_t left = (n - 1) / 2, right = n / 2;
+    while (K[left] == K[right] && left > 0) {
+        --left;
+        ++right;
+    }
 
-        if (right < left) {
-            K.back() = K.front();
-            all_nines = false;
-            return;
-        }
+    all_nines = false;
 
-        // We need to increment the middle value.
-        if (middle != 9) {
-            K.back() = K.front();
-            ++K[1];
-            all_nines = false;
-        } else {
-            if (left == 9 && right == 9) {
-                all_nines = true;
-            } else {
-                ++K[0]; // left is guaranteed not to be 9
-                K[1] = '0';
-                K.back() = K.front();
-            }
-        }
+    // If the left digit is bigger, reflecting the left half onto the right half already gives a
+    // bigger number, and the smallest such palindrome. Digits inside the pair already match.
+    if (K[left] > K[right]) {
+        std::reverse_copy(K, K + left + 1, K + n - left - 1);
+        return;
+    }
 
+    // Otherwise (K is a palindrome, or the right digit is bigger) the left half, middle digit
+    // included, must go up by one before it is reflected. Carry through the 9's at the center.
+    size_t i = (n - 1) / 2;
+    while (K[i] == '9' && i > 0) {
+        K[i] = '0';
+        --i;
+    }
+
+    if (K[i] == '9') { // The whole left half was 9's, and then so was K: put it back
+        std::fill(K, K + (n - 1) / 2 + 1, '9');
+        all_nines = true;
         return;
     }
 
-    std::vector<char> sub_K = std::vector<char>(K.begin() + 1, K.end() - 1);
-    bool sub_all_nines;
-    NextBiggestPalindrome(sub_K, sub_all_nines);
-    assert(sub_K.size() == K.size() - 2);
+    ++K[i];
+    std::reverse_copy(K, K + n / 2, K + n - n / 2);
+}
 
-    if (sub_all_nines) {
-        int left = CharToDigit(K.front()), right = CharToDigit(K.back());
-        if (left == 9 && right == 9) {
-            all_nines = true;
-        } else if (right < left) {
-            K.back() = K.front();
-            all_nines = false;
-        } else {
-            // Return F0...0F where F = digit after the first digit of K, number of 0's =
-            // K.size() - 2.
-            std::fill(K.begin() + 1, K.end() - 1, '0');
-            ++K.front();
-            K.back() = K.front();
-            all_nines = false;
-        }
-    } else {
-        std::copy(sub_K.begin(), sub_K.end(), K.begin() + 1); // Copy sub_K back into K
-        K.back() = K.front();
-        all_nines = false;
+void NextBiggestPalindrome(std::vector<char>& K, bool& all_nines) {
+    NextBiggestPalindrome(K.data(), K.size(), all_nines);
+}
+
+// Writes the next palindrome over the n digits at K. Returns true if the answer is one digit
+// longer (K was all 9's); then K holds its first n digits, 10...0, and the last one is a '1'.
+inline bool NextBiggestPalindromeInPlace(char* K, const size_t n) {
+    if (n == 0) return false;
+
+    bool all_nines;
+    NextBiggestPalindrome(K, n, all_nines);
+    if (all_nines) {
+        K[0] = '1';
+        std::fill(K + 1, K + n, '0');
     }
+
+    return all_nines;
 }
 
 // Optimized version (no copies).
@@ -486,9 +491,604 @@ void NextBiggestPalindromeIterative(std::string& K) {
 }
 
 
+// Batch drivers. The input is a line with the number of test cases, which is ignored, then one
+// number per line. A '\r' before a '\n' is kept as part of the line ending.
+
+enum class DriverMode { kStream, kBuffered, kMapped, kParallel, kPipeline };
+
+struct DriverOptions {
+    DriverMode mode = DriverMode::kStream;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_size = kIoBlockSize; // Bytes of input per unit of parallel or pipelined work
+};
+
+void WriteAll(const int fd, const char* data, size_t n) {
+    while (n > 0) {
+        ssize_t written = write(fd, data, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            perror("write");
+            exit(1);
+        }
+
+        data += written;
+        n -= written;
+    }
+}
+
+size_t ReadSome(const int fd, char* data, const size_t n) {
+    while (true) {
+        ssize_t got = read(fd, data, n);
+        if (got >= 0) return got;
+        if (errno != EINTR) {
+            perror("read");
+            exit(1);
+        }
+    }
+}
+
+// Collects output in one large block and hands it to write() when full, instead of a flush per
+// answer.
+class OutputBuffer {
+  public:
+    explicit OutputBuffer(const int fd) : fd_(fd), data_(kIoBlockSize), used_(0) {}
+    ~OutputBuffer() { Flush(); }
+
+    void Append(const char* p, const size_t n) {
+        if (used_ + n > data_.size()) {
+            Flush();
+            if (n > data_.size()) { // Too big to be worth copying
+                WriteAll(fd_, p, n);
+                return;
+            }
+        }
+
+        std::memcpy(data_.data() + used_, p, n);
+        used_ += n;
+    }
+
+    void Flush() {
+        WriteAll(fd_, data_.data(), used_);
+        used_ = 0;
+    }
+
+  private:
+    int fd_;
+    std::vector<char> data_;
+    size_t used_;
+};
+
+// Solves one line in place and appends the answer and the line's ending to `out`. `length`
+// excludes the '\n', which is added even if the last line lacks it.
+void SolveLine(char* line, const size_t length, OutputBuffer& out) {
+    size_t digits = length;
+    if (digits > 0 && line[digits - 1] == '\r') --digits;
+
+    bool grew = NextBiggestPalindromeInPlace(line, digits);
+    out.Append(line, digits);
+    if (grew) out.Append("1", 1);
+    out.Append(line + digits, length - digits);
+    out.Append("\n", 1);
+}
+
+// Reads large blocks into one reusable buffer and solves each complete line where it lies; a line
+// cut off at the end of a block is moved to the front before the next read, and the buffer only
+// grows for a line longer than itself.
+int RunBuffered(const int in_fd, const int out_fd) {
+    std::vector<char> in(kIoBlockSize);
+    OutputBuffer out(out_fd);
+    size_t begin = 0, scanned = 0, end = 0; // Unsolved bytes are in[begin, end), no '\n' before
+                                            // `scanned`
+    bool header = true, eof = false;
+
+    while (true) {
+        char* newline;
+        while ((newline = static_cast<char*>(
+                    std::memchr(in.data() + scanned, '\n', end - scanned))) != nullptr) {
+            size_t line_end = newline - in.data();
+            if (!header) SolveLine(in.data() + begin, line_end - begin, out);
+            header = false;
+            begin = scanned = line_end + 1;
+        }
+        scanned = end;
+
+        if (eof) {
+            if (begin < end && !header) SolveLine(in.data() + begin, end - begin, out);
+            break;
+        }
+
+        if (begin > 0) {
+            std::memmove(in.data(), in.data() + begin, end - begin);
+            end -= begin;
+            scanned -= begin;
+            begin = 0;
+        }
+        if (end == in.size()) in.resize(2 * in.size());
+
+        size_t got = ReadSome(in_fd, in.data() + end, in.size() - end);
+        if (got == 0) eof = true;
+        end += got;
+    }
+
+    return 0;
+}
+
+void WriteSlices(const int fd, iovec* slices, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, slices, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            perror("writev");
+            exit(1);
+        }
+
+        for (; count > 0 && size_t(written) >= slices->iov_len; ++slices, --count)
+            written -= slices->iov_len;
+        if (count > 0) {
+            slices->iov_base = static_cast<char*>(slices->iov_base) + written;
+            slices->iov_len -= written;
+        }
+    }
+}
+
+// Gathers slices of memory, merging those that touch, and writes them with one writev() per
+// kMaxSlices. Nothing is copied, so the slices must stay valid until Flush().
+class SliceWriter {
+  public:
+    explicit SliceWriter(const int fd) : fd_(fd) { slices_.reserve(kMaxSlices); }
+    ~SliceWriter() { Flush(); }
+
+    void Append(const char* p, const size_t n) {
+        if (n == 0) return;
+        if (!slices_.empty() &&
+            static_cast<const char*>(slices_.back().iov_base) + slices_.back().iov_len == p) {
+            slices_.back().iov_len += n;
+            return;
+        }
+
+        if (slices_.size() == kMaxSlices) Flush();
+        slices_.push_back({const_cast<char*>(p), n});
+    }
+
+    void Flush() {
+        WriteSlices(fd_, slices_.data(), slices_.size());
+        slices_.clear();
+    }
+
+  private:
+    int fd_;
+    std::vector<iovec> slices_;
+};
+
+// The body of the input, past the header line, in writable memory: a private mapping of a regular
+// file, or else everything read from the descriptor. The drivers only hand it regular files, so the
+// read is a fallback for ones that can't be mapped and never grows with a pipe.
+class BatchInput {
+  public:
+    explicit BatchInput(const int fd) : mapping_(nullptr), size_(0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                mapping_ = static_cast<char*>(mapping);
+                size_ = st.st_size;
+                madvise(mapping_, size_, MADV_SEQUENTIAL);
+            }
+        }
+
+        if (mapping_ == nullptr) {
+            buffer_.resize(kIoBlockSize);
+            for (size_t got; (got = ReadSome(fd, &buffer_[size_], buffer_.size() - size_)) > 0; ) {
+                size_ += got;
+                if (size_ == buffer_.size()) buffer_.resize(2 * buffer_.size());
+            }
+        }
+
+        char* data = mapping_ ? mapping_ : buffer_.data();
+        end_ = data + size_;
+        begin_ = static_cast<char*>(std::memchr(data, '\n', size_));
+        begin_ = begin_ ? begin_ + 1 : end_;
+        released_ = mapping_;
+    }
+
+    ~BatchInput() {
+        if (mapping_) munmap(mapping_, size_);
+    }
+
+    char* begin() const { return begin_; }
+    char* end() const { return end_; }
+
+    // Faults in the pages of [from, to) as writable in one call, instead of taking a copy-on-write
+    // fault per page as lines are solved. Only a hint: older kernels lack it.
+    void Prefault(char* from, char* to) const {
+#ifdef MADV_POPULATE_WRITE
+        if (mapping_ == nullptr) return;
+        char* start = mapping_ + (from - mapping_) / kPage * kPage;
+        madvise(start, to - start, MADV_POPULATE_WRITE);
+#endif
+    }
+
+    // Drops the private copies of the pages before `upto`, once they are written out, so memory
+    // stays bounded on inputs of any size.
+    void Release(char* upto) {
+        if (mapping_ == nullptr) return;
+        char* cut = mapping_ + (upto - mapping_) / kPage * kPage;
+        if (cut <= released_) return;
+        madvise(released_, cut - released_, MADV_DONTNEED);
+        released_ = cut;
+    }
+
+  private:
+    static const size_t kPage;
+    char* mapping_;
+    std::vector<char> buffer_;
+    size_t size_;
+    char* begin_;
+    char* end_;
+    char* released_; // Pages of the mapping before this are dropped
+};
+
+const size_t BatchInput::kPage = sysconf(_SC_PAGESIZE);
+
+// A run of whole lines, solved in place and then written out as slices of itself.
+struct Chunk {
+    char* begin;
+    char* end; // Just past a '\n', or the end of the input
+    std::vector<char*> grown; // Where an all 9's answer needs its extra '1'
+    bool done;
+};
+
+// Cuts [begin, end) at the first line boundary after every `size` bytes; a line longer than that
+// gets a chunk of its own.
+std::vector<Chunk> SplitChunks(char* begin, char* const end, const size_t size) {
+    std::vector<Chunk> chunks;
+    while (begin < end) {
+        char* cut = end;
+        if (size_t(end - begin) > size) {
+            cut = static_cast<char*>(std::memchr(begin + size - 1, '\n', end - begin - size + 1));
+            cut = cut ? cut + 1 : end;
+        }
+
+        chunks.push_back({begin, cut, {}, false});
+        begin = cut;
+    }
+
+    return chunks;
+}
+
+void SolveChunk(Chunk& chunk) {
+    for (char* line = chunk.begin; line < chunk.end; ) {
+        char* newline = static_cast<char*>(std::memchr(line, '\n', chunk.end - line));
+        char* line_end = newline ? newline : chunk.end;
+        size_t digits = line_end - line;
+        if (digits > 0 && line[digits - 1] == '\r') --digits;
+
+        if (NextBiggestPalindromeInPlace(line, digits)) chunk.grown.push_back(line + digits);
+        line = line_end + 1;
+    }
+}
+
+// Slices of the chunk between the '1's of its grown answers, and a '\n' after a last line that
+// lacks one.
+void WriteChunk(const Chunk& chunk, SliceWriter& out) {
+    char* from = chunk.begin;
+    for (char* at : chunk.grown) {
+        out.Append(from, at - from);
+        out.Append("1", 1);
+        from = at;
+    }
+
+    out.Append(from, chunk.end - from);
+    if (chunk.end > chunk.begin && chunk.end[-1] != '\n') out.Append("\n", 1);
+}
+
+// Solves a regular file in the mapping itself, kMapWindow bytes at a time, and writes the answers
+// as slices of it: runs of lines go out as one slice, and an all 9's line gets a separate "1"
+// slice for its extra digit. Anything but a regular file goes to RunBuffered.
+int RunMapped(const int in_fd, const int out_fd) {
+    struct stat st;
+    if (fstat(in_fd, &st) != 0 || !S_ISREG(st.st_mode)) return RunBuffered(in_fd, out_fd);
+
+    BatchInput input(in_fd);
+    SliceWriter out(out_fd);
+    for (Chunk& chunk : SplitChunks(input.begin(), input.end(), kMapWindow)) {
+        input.Prefault(chunk.begin, chunk.end);
+        SolveChunk(chunk);
+        WriteChunk(chunk, out);
+        out.Flush();
+        input.Release(chunk.end);
+    }
+
+    return 0;
+}
+
+// Splits the input into chunks and solves them on `threads` workers, which claim chunks in input
+// order from a shared counter, so a worker that lands on a huge line doesn't hold up the others
+// and chunks finish about in the order they are written. This thread writes each chunk as soon as
+// it and all chunks before it are solved. Anything but a regular file would have to be read whole
+// first, so it goes to RunPipeline, which holds a fixed number of chunks at a time.
+int RunPipeline(int in_fd, int out_fd, size_t threads, size_t chunk_size);
+
+int RunParallel(const int in_fd, const int out_fd, const size_t threads, const size_t chunk_size) {
+    struct stat st;
+    if (fstat(in_fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return RunPipeline(in_fd, out_fd, threads, chunk_size);
+
+    BatchInput input(in_fd);
+    std::vector<Chunk> chunks = SplitChunks(input.begin(), input.end(), chunk_size);
+
+    std::mutex mutex;
+    std::condition_variable solved;
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (size_t i; (i = next.fetch_add(1)) < chunks.size(); ) {
+                input.Prefault(chunks[i].begin, chunks[i].end);
+                SolveChunk(chunks[i]);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    chunks[i].done = true;
+                }
+                solved.notify_one();
+            }
+        });
+    }
+
+    SliceWriter out(out_fd);
+    char* flushed = input.begin();
+    for (Chunk& chunk : chunks) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            solved.wait(lock, [&] { return chunk.done; });
+        }
+
+        WriteChunk(chunk, out);
+        if (size_t(chunk.end - flushed) >= kMapWindow) {
+            out.Flush();
+            input.Release(chunk.end);
+            flushed = chunk.end;
+        }
+    }
+
+    out.Flush();
+    for (std::thread& worker : workers) worker.join();
+    return 0;
+}
+
+// Runs `attempt` until it succeeds: spinning first, then yielding, then sleeping, so a stage that
+// waits on a quiet pipe costs little CPU.
+template <class F>
+void WaitFor(F attempt) {
+    for (unsigned tries = 0; !attempt(); ++tries) {
+        if (tries < 64) continue;
+        else if (tries < 256) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+// Bounded queue between one producer thread and one consumer thread. Each side writes only its own
+// index and reads the other's with acquire ordering, so no locks are taken; Push() waits while the
+// ring is full, which is what applies backpressure.
+template <class T>
+class SpscRing {
+  public:
+    explicit SpscRing(const size_t capacity) : slots_(capacity), head_(0), tail_(0) {}
+
+    bool TryPush(const T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) return false;
+        slots_[tail % slots_.size()] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        value = slots_[head % slots_.size()];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void Push(const T& value) { WaitFor([&] { return TryPush(value); }); }
+
+    T Pop() {
+        T value;
+        WaitFor([&] { return TryPop(value); });
+        return value;
+    }
+
+  private:
+    std::vector<T> slots_;
+    std::atomic<size_t> head_; // Written by the consumer only
+    char padding_[64]; // Keeps the two indices off one cache line
+    std::atomic<size_t> tail_; // Written by the producer only
+};
+
+// A preallocated buffer of whole lines passed along the pipeline by index.
+struct LineBlock {
+    std::vector<char> data;
+    Chunk chunk; // The lines in `data`
+};
+
+// Streams the input through three stages: a reader thread fills free blocks with whole lines and
+// deals them out round-robin to `threads` compute threads, and this thread writes the solved blocks
+// back, visiting the compute threads in the same round-robin order, so the output keeps the input
+// order without a reordering step. Every link is an SpscRing of block indices, and written blocks
+// return to the reader through one more. The 2 * threads + 2 blocks of `chunk_size` bytes are all
+// the memory there is, so a slow writer stalls the reader instead of growing a queue.
+int RunPipeline(const int in_fd, const int out_fd, const size_t threads, const size_t chunk_size) {
+    const size_t kEndOfInput = SIZE_MAX;
+    std::vector<LineBlock> blocks(2 * threads + 2);
+    SpscRing<size_t> free_blocks(blocks.size());
+    std::vector<std::unique_ptr<SpscRing<size_t>>> to_compute, to_writer;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i].data.resize(chunk_size);
+        free_blocks.TryPush(i);
+    }
+    for (size_t t = 0; t < threads; ++t) {
+        to_compute.emplace_back(new SpscRing<size_t>(blocks.size() + 1));
+        to_writer.emplace_back(new SpscRing<size_t>(blocks.size() + 1));
+    }
+
+    std::thread reader([&] {
+        size_t next_compute = 0, current = free_blocks.Pop(), used = 0;
+        bool header = true;
+        while (true) {
+            std::vector<char>& data = blocks[current].data;
+            if (used == data.size()) data.resize(2 * data.size()); // A line longer than the block
+
+            size_t got = ReadSome(in_fd, data.data() + used, data.size() - used);
+            used += got;
+
+            if (header) { // Drop the first line
+                char* newline = static_cast<char*>(std::memchr(data.data(), '\n', used));
+                size_t skip = newline ? newline + 1 - data.data() : used;
+                std::memmove(data.data(), data.data() + skip, used - skip);
+                used -= skip;
+                header = (newline == nullptr);
+            }
+
+            // Pass on the complete lines; a partial last line moves to the front of the next block,
+            // unless this is the end of the input.
+            size_t whole = used;
+            if (got > 0) {
+                char* newline = static_cast<char*>(memrchr(data.data(), '\n', used));
+                if (newline == nullptr) continue;
+                whole = newline + 1 - data.data();
+            }
+
+            if (whole > 0) {
+                Chunk& chunk = blocks[current].chunk;
+                chunk.begin = data.data();
+                chunk.end = data.data() + whole;
+                chunk.grown.clear();
+                to_compute[next_compute]->Push(current);
+                next_compute = (next_compute + 1) % threads;
+
+                size_t next = free_blocks.Pop();
+                std::vector<char>& next_data = blocks[next].data;
+                if (next_data.size() < used - whole) next_data.resize(2 * (used - whole));
+                std::memcpy(next_data.data(), data.data() + whole, used - whole);
+                current = next;
+                used -= whole;
+            }
+
+            if (got == 0) break;
+        }
+
+        for (size_t t = 0; t < threads; ++t) // The writer meets the first of these in turn
+            to_compute[(next_compute + t) % threads]->Push(kEndOfInput);
+    });
+
+    std::vector<std::thread> computers;
+    for (size_t t = 0; t < threads; ++t) {
+        computers.emplace_back([&, t] {
+            for (size_t b; (b = to_compute[t]->Pop()) != kEndOfInput; ) {
+                SolveChunk(blocks[b].chunk);
+                to_writer[t]->Push(b);
+            }
+            to_writer[t]->Push(kEndOfInput);
+        });
+    }
+
+    SliceWriter out(out_fd);
+    for (size_t t = 0; ; t = (t + 1) % threads) {
+        size_t b = to_writer[t]->Pop();
+        if (b == kEndOfInput) break;
+        WriteChunk(blocks[b].chunk, out);
+        out.Flush(); // The slices point into the block
+        free_blocks.Push(b);
+    }
+
+    reader.join();
+    for (std::thread& computer : computers) computer.join();
+    return 0;
+}
+
+// Reads a count made of decimal digits only, which std::stoul would not check. Returns false
+// on anything else, including values that don't fit.
+bool ParseCount(const char* text, size_t& value) {
+    if (*text < '0' || *text > '9') return false;
+    char* end;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed > SIZE_MAX) return false;
+    value = std::max<size_t>(1, parsed);
+    return true;
+}
+
+// Parses the batch driver flags. Returns false if the arguments don't start with one, so the
+// LOCAL test flags and the lone number argument work as before. --threads and --chunk-size
+// only apply to --parallel and --pipeline.
+bool ParseDriverArgs(int argc, char **argv, DriverOptions& options) {
+    if (argc <= 1) return false;
+    std::string first{argv[1]};
+    if (first != "--buffered" && first != "--mapped" && first != "--parallel" &&
+        first != "--pipeline")
+        return false;
+
+    const char* threaded_flag = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg_str{argv[i]};
+        bool valid = true;
+        if (arg_str == "--buffered") {
+            options.mode = DriverMode::kBuffered;
+        } else if (arg_str == "--mapped") {
+            options.mode = DriverMode::kMapped;
+        } else if (arg_str == "--parallel") {
+            options.mode = DriverMode::kParallel;
+        } else if (arg_str == "--pipeline") {
+            options.mode = DriverMode::kPipeline;
+        } else if (arg_str == "--threads" && i + 1 < argc) {
+            threaded_flag = argv[i];
+            valid = ParseCount(argv[++i], options.threads);
+            arg_str += " " + std::string(argv[i]);
+        } else if (arg_str == "--chunk-size" && i + 1 < argc) {
+            threaded_flag = argv[i];
+            valid = ParseCount(argv[++i], options.chunk_size);
+            arg_str += " " + std::string(argv[i]);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::cerr << "Unrecognized argument: " << arg_str << std::endl;
+            exit(1);
+        }
+    }
+
+    if (threaded_flag != nullptr && options.mode != DriverMode::kParallel &&
+        options.mode != DriverMode::kPipeline) {
+        std::cerr << "Unrecognized argument: " << threaded_flag << std::endl;
+        exit(1);
+    }
+    return true;
+}
+
+int RunDriver(const DriverOptions& options) {
+    switch (options.mode) {
+        case DriverMode::kBuffered:
+            return RunBuffered(STDIN_FILENO, STDOUT_FILENO);
+        case DriverMode::kMapped:
+            return RunMapped(STDIN_FILENO, STDOUT_FILENO);
+        case DriverMode::kParallel:
+            return RunParallel(STDIN_FILENO, STDOUT_FILENO, options.threads, options.chunk_size);
+        case DriverMode::kPipeline:
+            return RunPipeline(STDIN_FILENO, STDOUT_FILENO, options.threads, options.chunk_size);
+        case DriverMode::kStream:
+            break;
+    }
+
+    return 1;
+}
+
+
 // Main
 
 int main(int argc, char **argv) {
+    DriverOptions options;
+    if (ParseDriverArgs(argc, argv, options)) return RunDriver(options);
     if (ParseArgsAndTest(argc, argv)) return 0;
 
     std::string t;